@@ -0,0 +1,123 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "BatteryMonitor.h"
+
+// 2^BATTERY_AVERAGE_SHIFT times the averaged reading, 64 * 1023 still fits
+static volatile uint16_t averageSum;
+static volatile byte burstLeft; // conversions still to come in this burst
+
+static void addSample(uint16_t sample)
+{
+    averageSum = averageSum - (averageSum >> BATTERY_AVERAGE_SHIFT) + sample;
+}
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static uint16_t startAdc(byte pin)
+{
+    if (pin >= 14) pin -= 14; // A0 is channel 0
+    ADMUX = _BV(REFS0) | (pin & 0x07); // AVcc reference, same as analogRead()
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    while (ADCSRA & _BV(ADSC)) {}
+    uint16_t sample = ADC;
+    // from now on conversions are single ones started by startBurst() and the interrupt
+    ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+    return sample;
+}
+
+static void startBurst()
+{
+    ADCSRA |= _BV(ADSC);
+}
+
+ISR(ADC_vect)
+{
+    addSample(ADC);
+    if (--burstLeft > 0) ADCSRA |= _BV(ADSC);
+}
+
+#else
+// host build: the virtual board samples the pin once a conversion time
+#include <SimHal.h>
+
+#define ADC_CONVERSION_US 104 // 13 ADC clocks at 125kHz
+
+static byte adcPin;
+
+static void adcInterrupt()
+{
+    addSample(simReadAnalog(adcPin));
+    if (--burstLeft == 0) simIsrTimer(adcInterrupt, 0);
+}
+
+static uint16_t startAdc(byte pin)
+{
+    adcPin = pin;
+    return simReadAnalog(pin);
+}
+
+static void startBurst()
+{
+    simIsrTimer(adcInterrupt, ADC_CONVERSION_US);
+}
+#endif
+
+//==============================================
+BatteryMonitor::BatteryMonitor(byte pin, uint16_t fullScaleMv, uint16_t lowMv, uint16_t recoverMv)
+{
+    _pin = pin;
+    _fullScaleMv = fullScaleMv;
+    _lowMv = lowMv;
+    _recoverMv = recoverMv;
+    _low = false;
+}
+
+void BatteryMonitor::begin()
+{
+    pinMode(_pin, INPUT);
+    uint16_t sample = startAdc(_pin);
+    noInterrupts();
+    averageSum = sample << BATTERY_AVERAGE_SHIFT;
+    interrupts();
+}
+
+void BatteryMonitor::sample()
+{
+    // only the interrupt changes it while it isn't 0, and it stops at 0
+    if (burstLeft > 0) return;
+    burstLeft = BATTERY_BURST;
+    startBurst();
+}
+
+uint16_t BatteryMonitor::millivolts()
+{
+    noInterrupts();
+    uint16_t sum = averageSum;
+    interrupts();
+    return ((uint32_t)sum * _fullScaleMv) / ((uint32_t)BATTERY_ADC_MAX << BATTERY_AVERAGE_SHIFT);
+}
+
+boolean BatteryMonitor::isLow()
+{
+    uint16_t mv = millivolts();
+    if (mv < _lowMv) _low = true;
+    else if (mv > _recoverMv) _low = false;
+    return _low;
+}
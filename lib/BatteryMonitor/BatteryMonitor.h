@@ -0,0 +1,65 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef BATTERYMONITOR_H
+#define BATTERYMONITOR_H
+
+#include "Arduino.h"
+
+#define BATTERY_AVERAGE_SHIFT 6 // the average follows the last 2^6 conversions or so
+#define BATTERY_BURST 8 // conversions per sample(), a few hundred microseconds of ADC time
+#define BATTERY_ADC_MAX 1023
+
+class BatteryMonitor
+{
+public:
+    /**
+     * Keeps a moving average of a cell voltage. sample() starts a short burst of
+     * conversions, each one's interrupt adds the result in and starts the next,
+     * so reading the voltage never waits for a conversion and the ADC is idle,
+     * and wakes nobody, the rest of the time.
+     * Nothing else may use analogRead() while this runs.
+     * pin - Analog pin the cell is connected to.
+     * fullScaleMv - Voltage that reads as 1023.
+     * lowMv - Below this the battery is low.
+     * recoverMv - And it stays low until the voltage goes back above this.
+     */
+    BatteryMonitor(byte pin, uint16_t fullScaleMv, uint16_t lowMv, uint16_t recoverMv);
+    /**
+     * Takes one blocking reading to start the average from.
+     */
+    void begin();
+    /**
+     * Start a burst of BATTERY_BURST conversions in the background, unless one
+     * is still running. Call about once a second, the average then follows the
+     * last 8 seconds or so.
+     */
+    void sample();
+    uint16_t millivolts();
+    /**
+     * Compare the average against the thresholds. Call this now and then, not from an interrupt.
+     */
+    boolean isLow();
+
+private:
+    byte _pin;
+    uint16_t _fullScaleMv;
+    uint16_t _lowMv;
+    uint16_t _recoverMv;
+    boolean _low;
+};
+
+#endif
@@ -0,0 +1,111 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "Decimal.h"
+
+#define SECOND_TENS 3 // the one digit that counts to 5
+#define MAX_SECONDS 59999UL // 999:59
+
+BcdCountdown::BcdCountdown()
+{
+    forget();
+}
+
+byte BcdCountdown::follow(unsigned long ms)
+{
+    if (!_known || (ms >= _floor + 1000) || (ms + BCD_COUNTDOWN_MAX_TICKS * 1000UL < _floor)) return resync(ms);
+    byte changed = 0;
+    while (ms < _floor) {
+        changed |= tick();
+        _floor -= 1000;
+    }
+    return changed;
+}
+
+byte BcdCountdown::digit(byte index)
+{
+    return _digits[index];
+}
+
+void BcdCountdown::forget()
+{
+    _known = false;
+}
+
+byte BcdCountdown::resync(unsigned long ms)
+{
+    unsigned long seconds = ms / 1000;
+    if (seconds > MAX_SECONDS) seconds = MAX_SECONDS;
+    _floor = seconds * 1000;
+    unsigned int minutes = seconds / 60;
+    byte secs = seconds % 60;
+    byte digits[BCD_COUNTDOWN_DIGITS] = {
+        (byte)(minutes / 100), (byte)(minutes / 10 % 10), (byte)(minutes % 10), (byte)(secs / 10), (byte)(secs % 10)
+    };
+    byte changed = 0;
+    for (byte i = 0; i < BCD_COUNTDOWN_DIGITS; i++) {
+        if (!_known || (digits[i] != _digits[i])) changed |= 1 << i;
+        _digits[i] = digits[i];
+    }
+    _known = true;
+    return changed;
+}
+
+// one second less, the digits that roll over borrow from the one before
+byte BcdCountdown::tick()
+{
+    byte changed = 0;
+    for (byte i = BCD_COUNTDOWN_DIGITS; i-- > 0;) {
+        changed |= 1 << i;
+        if (_digits[i] > 0) {
+            _digits[i]--;
+            break;
+        }
+        _digits[i] = (i == SECOND_TENS) ? 5 : 9;
+    }
+    return changed;
+}
+
+//==============================================
+// the digit for power, taken off value by subtracting
+static inline char decimalPlace(unsigned int& value, unsigned int power)
+{
+    char digit = '0';
+    while (value >= power) {
+        value -= power;
+        digit++;
+    }
+    return digit;
+}
+
+byte formatDecimal(char* out, unsigned int value)
+{
+    char* end = out;
+    char digit;
+    // unrolled by hand, a loop over a table of powers would read it from RAM
+    digit = decimalPlace(value, 10000);
+    if (digit != '0') *end++ = digit;
+    digit = decimalPlace(value, 1000);
+    if ((digit != '0') || (end != out)) *end++ = digit;
+    digit = decimalPlace(value, 100);
+    if ((digit != '0') || (end != out)) *end++ = digit;
+    digit = decimalPlace(value, 10);
+    if ((digit != '0') || (end != out)) *end++ = digit;
+    *end++ = '0' + value;
+    *end = '\0';
+    return end - out;
+}
@@ -0,0 +1,72 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  Decimal digits without dividing. The ATmega has no divide instruction, a
+  32-bit division is a library call of ~600 cycles and printing MM:SS takes
+  four of them, plus one per digit of every score.
+  BcdCountdown keeps the time left as one digit per byte and counts it down a
+  second at a time, like a clock would, so the display only learns which
+  digits changed. formatDecimal() turns a number into text by subtracting
+  powers of ten.
+*/
+
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include "Arduino.h"
+
+#define BCD_COUNTDOWN_DIGITS 5 // MMM:SS, 3 digits is as many minutes as can be typed in
+#define BCD_COUNTDOWN_MAX_TICKS 3 // seconds counted down at once, further off it is worked out again
+#define DECIMAL_MAX_LEN 5 // 65535
+
+class BcdCountdown
+{
+public:
+    BcdCountdown();
+    /**
+     * Follow ms, the time left, rounded down to the second. When it went down
+     * by a few seconds they are counted off the digits, anything else (the
+     * first call, time added, a jump) is worked out again from ms.
+     * Returns a bit for every digit that changed, bit n for digit(n).
+     * 999:59 is the most it shows.
+     */
+    byte follow(unsigned long ms);
+    /**
+     * 0-2 are the minutes, hundreds first, 3-4 the seconds.
+     */
+    byte digit(byte index);
+    /**
+     * The next follow() works the digits out again and reports them all as changed.
+     */
+    void forget();
+
+private:
+    byte resync(unsigned long ms);
+    byte tick();
+
+    byte _digits[BCD_COUNTDOWN_DIGITS];
+    unsigned long _floor; // ms where the second shown starts
+    boolean _known;
+};
+
+/**
+ * Write value into out as text, without leading zeros, and return its length.
+ * out needs room for DECIMAL_MAX_LEN characters and the terminating zero.
+ */
+byte formatDecimal(char* out, unsigned int value);
+
+#endif
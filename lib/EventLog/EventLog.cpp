@@ -0,0 +1,239 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Arduino.h"
+#include "EventLog.h"
+#include <Timebase.h>
+
+#define LOG_FREE 0xFF
+#define LOG_HEADER 0x80
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+
+static byte readByte(unsigned int address)
+{
+    return eeprom_read_byte((const uint8_t*)address);
+}
+
+static void writeByte(unsigned int address, byte value)
+{
+    eeprom_write_byte((uint8_t*)address, value);
+}
+
+static boolean ready()
+{
+    return eeprom_is_ready();
+}
+
+#else
+// host build: the EEPROM of the virtual board
+#include <SimHal.h>
+
+static byte readByte(unsigned int address)
+{
+    return simEepromRead(address);
+}
+
+static void writeByte(unsigned int address, byte value)
+{
+    simEepromWrite(address, value);
+}
+
+static boolean ready()
+{
+    return simEepromReady();
+}
+#endif
+
+//==============================================
+EventLog::EventLog(unsigned int start, unsigned int size)
+{
+    _start = start;
+    _size = size;
+    _head = start;
+    _lastSecond = 0;
+    _queueHead = 0;
+    _queueCount = 0;
+    _dumpAddress = start;
+    _modeNames = NULL;
+    _modeCount = 0;
+    _dumpSeconds = 0;
+    _dumpInGame = false;
+}
+
+unsigned int EventLog::next(unsigned int address)
+{
+    address++;
+    return (address == _start + _size) ? _start : address;
+}
+
+void EventLog::begin()
+{
+    // the end is the first erased byte after a written one, an erased log starts at the beginning
+    _head = _start;
+    byte previous = readByte(_start + _size - 1);
+    unsigned int address = _start;
+    for (unsigned int i = 0; i < _size; i++) {
+        byte current = readByte(address);
+        if ((current == LOG_FREE) && (previous != LOG_FREE)) {
+            _head = address;
+            break;
+        }
+        previous = current;
+        address = next(address);
+    }
+    _dumpAddress = _head;
+}
+
+void EventLog::queue(byte data)
+{
+    if (_queueCount >= EVENT_LOG_QUEUE_SIZE) return;
+    _queue[(_queueHead + _queueCount) & (EVENT_LOG_QUEUE_SIZE - 1)] = data;
+    _queueCount++;
+}
+
+void EventLog::add(LogEvent event, byte argument)
+{
+    // whole seconds from the one the previous record fell into, so the fractions add up
+    unsigned long delta = Timebase::since(_lastSecond) / 1000;
+    _lastSecond += delta * 1000;
+    if (event == LOG_GAME_START) delta = 0;
+    byte length = 1;
+    for (unsigned long rest = delta; rest > 0; rest >>= 7) length++;
+    if (_queueCount + length > EVENT_LOG_QUEUE_SIZE) return; // half a record would garble the next one
+    queue(LOG_HEADER | (event << 3) | (argument & 0x07));
+    for (; delta > 0; delta >>= 7) queue(delta & 0x7F);
+}
+
+void EventLog::update()
+{
+    if ((_queueCount == 0) || !ready()) return;
+    unsigned int after = next(_head);
+    // the oldest record gives way a byte at a time, the byte after the newest one stays erased
+    if (readByte(after) != LOG_FREE) {
+        writeByte(after, LOG_FREE);
+        return;
+    }
+    writeByte(_head, _queue[_queueHead]);
+    _queueHead = (_queueHead + 1) & (EVENT_LOG_QUEUE_SIZE - 1);
+    _queueCount--;
+    _head = after;
+}
+
+void EventLog::startDump(const char* const* modeNames, byte modeCount)
+{
+    _modeNames = modeNames;
+    _modeCount = modeCount;
+    _dumpSeconds = 0;
+    _dumpInGame = false;
+    // the oldest record is the first header after the erased bytes, a half overwritten one is skipped
+    _dumpAddress = next(_head);
+    while ((_dumpAddress != _head) && (readByte(_dumpAddress) == LOG_FREE)) {
+        _dumpAddress = next(_dumpAddress);
+    }
+    while ((_dumpAddress != _head) && !(readByte(_dumpAddress) & LOG_HEADER)) {
+        _dumpAddress = next(_dumpAddress);
+    }
+}
+
+static void printTwoDigits(Print& out, unsigned long value)
+{
+    if (value < 10) out.print('0');
+    out.print(value);
+}
+
+boolean EventLog::dumpNext(Print& out)
+{
+    if (_dumpAddress == _head) return false;
+    if (!ready()) return true;
+    byte header = readByte(_dumpAddress);
+    LogEvent event = (LogEvent)((header >> 3) & 0x0F);
+    byte argument = header & 0x07;
+    unsigned long delta = 0;
+    byte shift = 0;
+    _dumpAddress = next(_dumpAddress);
+    while (_dumpAddress != _head) {
+        byte digit = readByte(_dumpAddress);
+        if (digit & LOG_HEADER) break;
+        delta |= (unsigned long)digit << shift;
+        shift += 7;
+        _dumpAddress = next(_dumpAddress);
+    }
+
+    if (event == LOG_GAME_START) {
+        _dumpSeconds = 0;
+        _dumpInGame = true;
+        out.println();
+    } else {
+        _dumpSeconds += delta;
+    }
+    if (_dumpInGame) {
+        printTwoDigits(out, _dumpSeconds / 60);
+        out.print(':');
+        printTwoDigits(out, _dumpSeconds % 60);
+    } else {
+        out.print(F("--:--"));
+    }
+    out.print(' ');
+    switch (event) {
+        case LOG_GAME_START: {
+            out.print(F("start "));
+            // a mode the firmware was built without has no name
+            const char* name = (argument < _modeCount) ? (const char*)pgm_read_ptr(&_modeNames[argument]) : NULL;
+            if (name != NULL) out.print((const __FlashStringHelper*)name);
+            else out.print(argument);
+            break;
+        }
+        case LOG_GAME_END:
+            out.print(F("end"));
+            if (argument != LOG_NO_TEAM) {
+                out.print(F(", team "));
+                out.print(argument + 1);
+                out.print(F(" won"));
+            }
+            break;
+        case LOG_GAME_STOPPED:
+            out.print(F("stopped"));
+            break;
+        case LOG_ARMED:
+        case LOG_DISARMED:
+            out.print((event == LOG_ARMED) ? F("armed") : F("disarmed"));
+            out.print(argument ? F(" with buttons") : F(" with code"));
+            break;
+        case LOG_BAD_CODE:
+            out.print(F("bad code"));
+            if (argument > 0) {
+                out.print(' ');
+                out.print(argument);
+            }
+            break;
+        case LOG_TEAM_SWITCH:
+            out.print(F("team "));
+            out.print(argument + 1);
+            out.print(F(" took the point"));
+            break;
+        case LOG_EXPLODED:
+            out.print(F("exploded"));
+            break;
+        default:
+            out.print(F("? "));
+            out.print(header, HEX);
+            break;
+    }
+    out.println();
+    return _dumpAddress != _head;
+}
@@ -0,0 +1,94 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef EVENTLOG_H
+#define EVENTLOG_H
+
+#include "Arduino.h"
+
+#define EVENT_LOG_QUEUE_SIZE 16 // record bytes waiting for the EEPROM, must be a power of two
+#define LOG_NO_TEAM 7 // the argument of an event nobody in particular caused
+
+typedef enum {
+    LOG_GAME_START, // argument: the game mode
+    LOG_GAME_END, // argument: the winning team, LOG_NO_TEAM if there is none
+    LOG_GAME_STOPPED, // left for the menu before the game ended
+    LOG_ARMED, // argument: 0 with the code, 1 with the buttons
+    LOG_DISARMED, // like armed
+    LOG_BAD_CODE, // argument: bad codes so far while armed, 0 for a bad arming code
+    LOG_TEAM_SWITCH, // argument: the team that took the point
+    LOG_EXPLODED,
+    LOG_EVENTS
+} LogEvent;
+
+class EventLog
+{
+public:
+    /**
+     * Game events in a ring of EEPROM bytes, starting at address start.
+     * A record is a header byte with the top bit set, holding the event and a
+     * 3 bit argument, followed by the seconds since the previous record in
+     * 7 bit digits, lowest first, as many as it takes (none for 0).
+     * Game starts carry no time, the times after them count from there.
+     * An erased byte (0xFF) always follows the newest record, that is how
+     * begin() finds the end again after a reset. The ring wraps and the oldest
+     * records make way for new ones. Every byte is erased ahead of the head and
+     * then written, two EEPROM write cycles per lap.
+     */
+    EventLog(unsigned int start, unsigned int size);
+    /**
+     * Finds where the last run left off.
+     */
+    void begin();
+    /**
+     * Queue an event that happened now. Dropped if the queue is full.
+     */
+    void add(LogEvent event, byte argument);
+    /**
+     * Writes at most one byte to the EEPROM, and only when it is not busy
+     * with the previous one, so it never waits. Call once per loop().
+     */
+    void update();
+    /**
+     * Start printing the log, oldest record first. modeNames holds a PROGMEM
+     * string for every game mode, or NULL to print its number, and lives in PROGMEM itself.
+     */
+    void startDump(const char* const* modeNames, byte modeCount);
+    /**
+     * Prints the next record as a line of text. Returns false once the log is
+     * done, and true without printing while the EEPROM is busy.
+     */
+    boolean dumpNext(Print& out);
+
+private:
+    unsigned int next(unsigned int address);
+    void queue(byte data);
+
+    unsigned int _start;
+    unsigned int _size;
+    unsigned int _head; // where the next byte goes
+    unsigned long _lastSecond; // start of the second the previous record fell into
+    byte _queue[EVENT_LOG_QUEUE_SIZE];
+    byte _queueHead;
+    byte _queueCount;
+
+    unsigned int _dumpAddress; // at a header byte while dumping, _head when done
+    const char* const* _modeNames;
+    byte _modeCount;
+    unsigned long _dumpSeconds; // since the game started
+    boolean _dumpInGame; // a game start was seen, so the times are known
+};
+
+#endif
@@ -0,0 +1,181 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  Pin access resolved at compile time. On the ATmega328P every pin maps to a
+  PINx/DDRx/PORTx triplet in the low I/O space, so with the pin number known
+  to the compiler a write is a single sbi/cbi and a read a single in or sbis,
+  instead of the table lookups digitalRead() and digitalWrite() do.
+  sbi and cbi are also atomic, so an interrupt can own one pin of a port
+  while loop() writes another.
+  Arduino numbering: 0-7 are port D, 8-13 port B, 14-19 (A0-A5) port C.
+*/
+
+#ifndef FASTPIN_H
+#define FASTPIN_H
+
+#include "Arduino.h"
+
+#if !defined(__AVR__)
+#include <SimHal.h>
+#endif
+
+template <uint8_t pin>
+class FastPin
+{
+    static_assert(pin < 20, "only the 20 pins of the ATmega328P are known");
+
+public:
+    // I/O address of PINx, DDRx and PORTx follow it
+    static constexpr uint8_t pinReg = (pin < 8) ? 0x09 : ((pin < 14) ? 0x03 : 0x06);
+    static constexpr uint8_t mask = 1 << ((pin < 8) ? pin : ((pin < 14) ? (pin - 8) : (pin - 14)));
+
+#if defined(__AVR__)
+    static inline void output() { _SFR_IO8(pinReg + 1) |= mask; }
+    static inline void input() { _SFR_IO8(pinReg + 1) &= ~mask; _SFR_IO8(pinReg + 2) &= ~mask; }
+    static inline void inputPullup() { _SFR_IO8(pinReg + 1) &= ~mask; _SFR_IO8(pinReg + 2) |= mask; }
+    static inline void high() { _SFR_IO8(pinReg + 2) |= mask; }
+    static inline void low() { _SFR_IO8(pinReg + 2) &= ~mask; }
+    // writing a one to PINx flips the output
+    static inline void toggle() { _SFR_IO8(pinReg) = mask; }
+    static inline boolean read() { return _SFR_IO8(pinReg) & mask; }
+#else
+    static inline void output() { simPinMode(pin, OUTPUT); }
+    static inline void input() { simPinMode(pin, INPUT); }
+    static inline void inputPullup() { simPinMode(pin, INPUT_PULLUP); }
+    static inline void high() { simWritePin(pin, HIGH); }
+    static inline void low() { simWritePin(pin, LOW); }
+    static inline void toggle() { simWritePin(pin, !simPinLevel(pin)); }
+    static inline boolean read() { return simReadPin(pin); }
+#endif
+
+    static inline void write(boolean level)
+    {
+        if (level) high();
+        else low();
+    }
+};
+
+/**
+ * Two pins on the same port, sampled with one read so both are seen at the same instant.
+ */
+template <uint8_t pinA, uint8_t pinB>
+class FastPinPair
+{
+    typedef FastPin<pinA> A;
+    typedef FastPin<pinB> B;
+    static_assert(A::pinReg == B::pinReg, "both pins must be on one port");
+
+public:
+    static inline void inputPullup()
+    {
+        A::inputPullup();
+        B::inputPullup();
+    }
+    /**
+     * Bit 0 is set when pinA is low, bit 1 when pinB is. For buttons to ground that is "pressed".
+     */
+    static inline uint8_t readLow()
+    {
+#if defined(__AVR__)
+        uint8_t port = ~_SFR_IO8(A::pinReg);
+#else
+        uint8_t port = (simReadPin(pinA) ? 0 : A::mask) | (simReadPin(pinB) ? 0 : B::mask);
+#endif
+        return ((port & A::mask) ? 0x01 : 0) | ((port & B::mask) ? 0x02 : 0);
+    }
+};
+
+/**
+ * Any number of pins, on any ports, handled as a row of bits: the first pin is bit 0.
+ * Everything unrolls at compile time, so a call is the same sbi/cbi/sbis sequence
+ * as naming each pin by hand. An index that is not a constant costs a compare per pin.
+ */
+template <uint8_t... pins>
+class FastPinList;
+
+template <>
+class FastPinList<>
+{
+public:
+    static constexpr uint8_t count = 0;
+    static inline void output() {}
+    static inline void inputPullup() {}
+    static inline void low() {}
+    static inline void outputLow(uint8_t) {}
+    static inline void inputPullup(uint8_t) {}
+    static inline uint8_t readLow() { return 0; }
+    static constexpr bool usesPort(uint8_t) { return false; }
+};
+
+template <uint8_t first, uint8_t... rest>
+class FastPinList<first, rest...>
+{
+    typedef FastPin<first> Head;
+    typedef FastPinList<rest...> Tail;
+
+public:
+    static constexpr uint8_t count = 1 + sizeof...(rest);
+
+    static inline void output()
+    {
+        Head::output();
+        Tail::output();
+    }
+    static inline void inputPullup()
+    {
+        Head::inputPullup();
+        Tail::inputPullup();
+    }
+    static inline void low()
+    {
+        Head::low();
+        Tail::low();
+    }
+    /**
+     * Sink the pin at index, the others are left alone.
+     */
+    static inline void outputLow(uint8_t index)
+    {
+        if (index == 0) {
+            Head::low(); // the latch goes low first, so the pin never drives high
+            Head::output();
+        } else {
+            Tail::outputLow(index - 1);
+        }
+    }
+    static inline void inputPullup(uint8_t index)
+    {
+        if (index == 0) Head::inputPullup();
+        else Tail::inputPullup(index - 1);
+    }
+    /**
+     * Bit n is set when the n-th pin reads low.
+     */
+    static inline uint8_t readLow()
+    {
+        return (Head::read() ? 0 : 0x01) | (Tail::readLow() << 1);
+    }
+    /**
+     * True if any of the pins is on the port whose PINx is at this I/O address.
+     */
+    static constexpr bool usesPort(uint8_t pinReg)
+    {
+        return (Head::pinReg == pinReg) || Tail::usesPort(pinReg);
+    }
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "GameEngine.h"
+
+#include <stddef.h>
+
+GameEngine::GameEngine(const GameMode* modes, byte count)
+{
+    _modes = modes;
+    _count = count;
+    _active = GAME_NONE;
+    _running = false;
+}
+
+// every handler is a function pointer, so one read fits them all
+GameEngine::Handler GameEngine::handler(byte offset)
+{
+    if (_active == GAME_NONE) return NULL;
+    return (Handler)pgm_read_ptr((const byte*)&_modes[_active] + offset);
+}
+
+void GameEngine::start(byte mode)
+{
+    if (mode >= _count) return;
+    stop();
+    _active = mode;
+    _running = true;
+    Handler enter = handler(offsetof(GameMode, enter));
+    if (enter != NULL) enter();
+}
+
+void GameEngine::finish()
+{
+    _running = false;
+}
+
+void GameEngine::stop()
+{
+    Handler exit = handler(offsetof(GameMode, exit));
+    _active = GAME_NONE;
+    _running = false;
+    if (exit != NULL) exit();
+}
+
+void GameEngine::update()
+{
+    if (!_running) return;
+    Handler update = handler(offsetof(GameMode, update));
+    if (update != NULL) update();
+}
+
+void GameEngine::input(char key)
+{
+    if (!_running) return;
+    void (*input)(char) = (void (*)(char))handler(offsetof(GameMode, input));
+    if (input != NULL) input(key);
+}
+
+void GameEngine::buttons(unsigned long now)
+{
+    if (!_running) return;
+    void (*buttons)(unsigned long) = (void (*)(unsigned long))handler(offsetof(GameMode, buttons));
+    if (buttons != NULL) buttons(now);
+}
+
+byte GameEngine::active()
+{
+    return _active;
+}
+
+boolean GameEngine::isRunning()
+{
+    return _running;
+}
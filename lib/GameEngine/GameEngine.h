@@ -0,0 +1,76 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMEENGINE_H
+#define GAMEENGINE_H
+
+#include "Arduino.h"
+
+#define GAME_NONE 0xFF // no mode selected, the menu has the keypad
+
+/**
+ * Handlers of one game mode, any of them may be NULL.
+ * The table of modes is meant to live in PROGMEM.
+ */
+struct GameMode {
+    void (*enter)(); // set the mode up, called by start()
+    void (*update)(); // once per loop() while the game runs
+    void (*input)(char key); // a key was pressed while the game runs
+    void (*buttons)(unsigned long now); // the team buttons moved, or time passed while they are held
+    void (*exit)(); // the mode is left, called by stop() and by start() of another one
+};
+
+class GameEngine
+{
+public:
+    /**
+     * Runs one mode of modes at a time. The loop only calls into the active
+     * mode's handlers, each mode keeps its own state.
+     * modes - Table of count modes in PROGMEM, a mode is its index in it.
+     */
+    GameEngine(const GameMode* modes, byte count);
+    /**
+     * Leave the active mode and enter this one. The game runs until finish() or stop().
+     */
+    void start(byte mode);
+    /**
+     * The game is over. The mode stays selected with its final screen, but gets no more calls.
+     */
+    void finish();
+    /**
+     * Leave the active mode, back to the menu.
+     */
+    void stop();
+    void update();
+    void input(char key);
+    void buttons(unsigned long now);
+    /**
+     * The selected mode, running or finished, or GAME_NONE.
+     */
+    byte active();
+    boolean isRunning();
+
+private:
+    typedef void (*Handler)();
+    Handler handler(byte offset);
+
+    const GameMode* _modes;
+    byte _count;
+    byte _active;
+    boolean _running;
+};
+
+#endif
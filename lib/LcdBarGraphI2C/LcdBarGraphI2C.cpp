@@ -30,10 +30,10 @@
 #include "LcdBarGraphI2C.h"
 
 
-// -- initializing bar segment characters
+// -- bar segment characters, in flash, they go to the display through the frame buffer's CGRAM slots
 #ifndef USE_BUILDIN_FILLED_CHAR
 // -- filled character
-byte LcdBarGraphI2C::_level0[8] = {
+const byte LcdBarGraphI2C::_level0[8] PROGMEM = {
     B11111,
     B11111,
     B11111,
@@ -45,53 +45,24 @@ byte LcdBarGraphI2C::_level0[8] = {
 };
 #endif
 
-// -- character with one bar
-byte LcdBarGraphI2C::_level1[8] = {
-    B10000,
-    B10000,
-    B10000,
-    B10000,
-    B10000,
-    B10000,
-    B10000,
-    B10000
-};
-// -- character with two bars
-byte LcdBarGraphI2C::_level2[8] = {
-    B11000,
-    B11000,
-    B11000,
-    B11000,
-    B11000,
-    B11000,
-    B11000,
-    B11000
-};
-// -- character with three bars
-byte LcdBarGraphI2C::_level3[8] = {
-    B11100,
-    B11100,
-    B11100,
-    B11100,
-    B11100,
-    B11100,
-    B11100,
-    B11100
-};
-// -- character with four bars
-byte LcdBarGraphI2C::_level4[8] = {
-    B11110,
-    B11110,
-    B11110,
-    B11110,
-    B11110,
-    B11110,
-    B11110,
-    B11110
+// -- characters with one to four bars, from the left and then from the right for reverse bars
+const byte LcdBarGraphI2C::_levels[2][4][8] PROGMEM = {
+    {
+        { B10000, B10000, B10000, B10000, B10000, B10000, B10000, B10000 },
+        { B11000, B11000, B11000, B11000, B11000, B11000, B11000, B11000 },
+        { B11100, B11100, B11100, B11100, B11100, B11100, B11100, B11100 },
+        { B11110, B11110, B11110, B11110, B11110, B11110, B11110, B11110 }
+    },
+    {
+        { B00001, B00001, B00001, B00001, B00001, B00001, B00001, B00001 },
+        { B00011, B00011, B00011, B00011, B00011, B00011, B00011, B00011 },
+        { B00111, B00111, B00111, B00111, B00111, B00111, B00111, B00111 },
+        { B01111, B01111, B01111, B01111, B01111, B01111, B01111, B01111 }
+    }
 };
 
 // -- constructor
-LcdBarGraphI2C::LcdBarGraphI2C(LiquidCrystal_I2C* lcd, byte numCols, byte startX, byte startY)
+LcdBarGraphI2C::LcdBarGraphI2C(LcdFrameBuffer* lcd, byte numCols, byte startX, byte startY)
 {
     // -- setting fields
     _lcd = lcd;
@@ -102,70 +73,82 @@ LcdBarGraphI2C::LcdBarGraphI2C(LiquidCrystal_I2C* lcd, byte numCols, byte startX
 
 void LcdBarGraphI2C::begin()
 {
-    // -- creating characters
-#ifndef USE_BUILDIN_FILLED_CHAR
-    _lcd->createChar(0, this->_level0);
-#endif
-    _lcd->createChar(1, this->_level1);
-    _lcd->createChar(2, this->_level2);
-    _lcd->createChar(3, this->_level3);
-    _lcd->createChar(4, this->_level4);
-    _lcd->clear(); // put lcd back into DDRAM mode
-    // -- setting initial values
+    // -- setting initial values, the characters are uploaded when they are first drawn
     this->_prevValue = 0; // -- cached value
-    this->_lastFullChars = 0; // -- cached value
+    this->_prevDirection = BAR_FORWARD;
+    this->_blanked = _lcd->blanked() - 1; // -- the first draw blanks the cells under the bar
 	this->_initialized = true;
 }
 
+// -- rewrite the cells of a run whose fill goes from `from` fifths to `to` fifths
+// -- first is the column the run fills from, it grows to the left when reversed
+void LcdBarGraphI2C::drawRun(int from, int to, byte length, byte first, boolean reversed)
+{
+    if (from == to) return;
+    int low = (from < to) ? from : to;
+    int high = (from < to) ? to : from;
+    int last = (high + 4) / 5; // -- one past the last cell that changes
+    if (last > length) last = length;
+    for (byte cell = low / 5; cell < last; cell++) {
+        int fill = to - cell * 5;
+        byte glyph;
+        if (fill >= 5) {
+#ifdef USE_BUILDIN_FILLED_CHAR
+            glyph = USE_BUILDIN_FILLED_CHAR;  // -- use build in filled char
+#else
+            glyph = _lcd->glyph(_level0);
+#endif
+        } else if (fill <= 0) {
+            glyph = ' ';
+        } else {
+            glyph = _lcd->glyph(_levels[reversed][fill - 1]); // -- the right partial character
+        }
+        _lcd->setCursor(reversed ? (first - cell) : (first + cell), _startY);
+        _lcd->write(glyph);
+    }
+}
+
 // -- the draw function
-void LcdBarGraphI2C::drawValue(int value, int maxValue) {
+void LcdBarGraphI2C::drawValue(int value, int maxValue, BarDirection direction) {
 	if(!this->_initialized) {
 		this->begin();
 	}
-    // -- calculate full (filled) character count
-    byte fullChars = (long)value * _numCols / maxValue;
-    // -- calculate partial character bar count
-    byte mod = ((long)value * _numCols * 5 / maxValue) % 5;
+    // -- a centered bar has half of the cells on each side
+    byte length = (direction == BAR_CENTER) ? (_numCols / 2) : _numCols;
+    int full = length * 5;
+    // -- the bar in fifths of a cell
+    int normalizedValue = (long)value * full / maxValue;
+    int empty = (direction == BAR_CENTER) ? -full : 0;
+    if (normalizedValue > full) normalizedValue = full;
+    if (normalizedValue < empty) normalizedValue = empty;
 
-    // -- if value does not change, do not draw anything
-    int normalizedValue = (int)fullChars * 5 + mod;
-    if(this->_prevValue != normalizedValue) {
-        // -- do not clear the display to eliminate flickers
+    // -- the cells under the bar were wiped, or they hold a bar going the other way
+    if ((_lcd->blanked() != this->_blanked) || (direction != this->_prevDirection)) {
         _lcd->setCursor(_startX, _startY);
-        
-        // -- write filled characters
-        for(byte i=0; i<fullChars; i++) {
-#ifdef USE_BUILDIN_FILLED_CHAR
-            _lcd->write((byte)USE_BUILDIN_FILLED_CHAR);  // -- use build in filled char
-#else
-            _lcd->write((byte)0);
-#endif
-        }
-        
-        // -- write the partial character
-        if(mod > 0) {
-            _lcd->write(mod); // -- index the right partial character
-            ++fullChars;
-        }
-        
-        // -- clear characters left over the previous draw
-        for(byte i=fullChars;i<this->_lastFullChars;i++) {
+        for (byte i = 0; i < _numCols; i++) {
             _lcd->write(' ');
         }
-        
-        // -- save cache
-        this->_lastFullChars = fullChars;
+        this->_prevValue = 0;
+        this->_prevDirection = direction;
+    }
+
+    // -- if value does not change, do not draw anything
+    // -- otherwise only the cells between the old and the new end of the bar change
+    if (this->_prevValue != normalizedValue) {
+        if (direction == BAR_FORWARD) {
+            drawRun(this->_prevValue, normalizedValue, length, _startX, false);
+        } else if (direction == BAR_REVERSE) {
+            drawRun(this->_prevValue, normalizedValue, length, _startX + _numCols - 1, true);
+        } else {
+            // -- the left side fills with the negative part, the right side with the positive
+            int prevLeft = (this->_prevValue < 0) ? -this->_prevValue : 0;
+            int left = (normalizedValue < 0) ? -normalizedValue : 0;
+            drawRun(prevLeft, left, length, _startX + length - 1, true);
+            int prevRight = (this->_prevValue > 0) ? this->_prevValue : 0;
+            int right = (normalizedValue > 0) ? normalizedValue : 0;
+            drawRun(prevRight, right, length, _startX + _numCols - length, false);
+        }
         this->_prevValue = normalizedValue;
     }
-    /*
-    // debug info
-    _lcd->setCursor(0,1);
-    _lcd->write('[');
-    _lcd->print((int)value);
-    _lcd->write(' ');
-    _lcd->print(normalizedValue);
-    _lcd->write(' ');
-    _lcd->print((int)mod);
-    _lcd->write(']');
-    */
+    this->_blanked = _lcd->blanked();
 }
@@ -29,12 +29,18 @@
 #ifndef LCDBARGRAPH_H
 #define LCDBARGRAPH_H
 
-#include <LiquidCrystal_I2C.h>
+#include <LcdFrameBuffer.h>
 
 #include "Arduino.h"
 
 #define USE_BUILDIN_FILLED_CHAR  0xFF // -- Char 0xFF is usualy a filled character. Uncomment if you want the library to create the filled char at the expense of 26 bytes.
 
+enum BarDirection : byte {
+    BAR_FORWARD, // -- fills from the left
+    BAR_REVERSE, // -- fills from the right
+    BAR_CENTER // -- from the middle, a negative value to the left and a positive one to the right
+};
+
 class LcdBarGraphI2C
 {
 public:
@@ -42,37 +48,38 @@ public:
      * Create an instance of the class. The bar will be drawn in the startY row 
 	 * of the LiquidCrystal_I2C, from the startX column positon (inclusive) to to the startX+numCols column position
 	 * (inclusive).
-	 * lcd - A LiquidCristal instance should be passed.
+	 * lcd - The LcdFrameBuffer of the display, the bar is drawn through it.
 	 * numCols - Width of the bar.
 	 * startX - Horzontal starting position (column) of the bar. Zero based value.
 	 * startY - Vertical starting position (row) of the bar. Zero based value.
      */
-    LcdBarGraphI2C(LiquidCrystal_I2C* lcd, byte numCols, byte startX = 0, byte startY = 0);
+    LcdBarGraphI2C(LcdFrameBuffer* lcd, byte numCols, byte startX = 0, byte startY = 0);
     /**
-     * Draw a bargraph with a value between 0 and maxValue.
+     * Draw a bargraph with a value between 0 and maxValue, -maxValue and maxValue when centered.
+     * Only the cells that differ from the last draw are written.
      */
-    void drawValue(int value, int maxvalue);
+    void drawValue(int value, int maxvalue, BarDirection direction = BAR_FORWARD);
    /**
-    * Initializes the display.
+    * Forgets what was drawn, the next draw starts on blank cells.
     */
    void begin();
 	
 private:
-    LiquidCrystal_I2C* _lcd;
+    void drawRun(int from, int to, byte length, byte first, boolean reversed);
+
+    LcdFrameBuffer* _lcd;
     byte _numCols;
     byte _startX;
     byte _startY;
-    int _prevValue;
-    byte _lastFullChars;
+    int _prevValue; // -- in fifths of a cell, signed when centered
+    BarDirection _prevDirection;
+    byte _blanked; // -- of the frame buffer at the last draw
 	boolean _initialized = false;
 
 #ifndef USE_BUILDIN_FILLED_CHAR
-    static byte _level0[8];
+    static const byte _level0[8];
 #endif
-    static byte _level1[8];
-    static byte _level2[8];
-    static byte _level3[8];
-    static byte _level4[8];
+    static const byte _levels[2][4][8];
 };
 
 #endif
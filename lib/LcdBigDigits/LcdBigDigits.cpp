@@ -0,0 +1,96 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "LcdBigDigits.h"
+
+#define FULL 0xFF // the built-in block
+#define NOTHING ' '
+#define NO_DIGIT 0xFF
+#define COLON 0xA5 // a dot in the middle of the cell, one on each row looks like a colon
+
+enum Segment : byte { SEG_NONE, SEG_FULL, SEG_TOP, SEG_BOTTOM, SEG_BOTH };
+
+// a bar three pixels thick at the top, at the bottom and at both
+static const byte topBar[8] PROGMEM = { B11111, B11111, B11111, B00000, B00000, B00000, B00000, B00000 };
+static const byte bottomBar[8] PROGMEM = { B00000, B00000, B00000, B00000, B00000, B11111, B11111, B11111 };
+static const byte bothBars[8] PROGMEM = { B11111, B11111, B11111, B00000, B00000, B11111, B11111, B11111 };
+
+// the 6 cells of each digit, top row left to right, then the bottom row, 4 bits a cell
+static const uint16_t digitCells[10][2] PROGMEM = {
+#define CELLS(a, b, c) ((uint16_t)(a) | ((uint16_t)(b) << 4) | ((uint16_t)(c) << 8))
+    { CELLS(SEG_FULL, SEG_TOP, SEG_FULL), CELLS(SEG_FULL, SEG_BOTTOM, SEG_FULL) }, // 0
+    { CELLS(SEG_NONE, SEG_NONE, SEG_FULL), CELLS(SEG_NONE, SEG_NONE, SEG_FULL) }, // 1
+    { CELLS(SEG_BOTH, SEG_BOTH, SEG_FULL), CELLS(SEG_FULL, SEG_BOTTOM, SEG_BOTTOM) }, // 2
+    { CELLS(SEG_BOTH, SEG_BOTH, SEG_FULL), CELLS(SEG_BOTTOM, SEG_BOTTOM, SEG_FULL) }, // 3
+    { CELLS(SEG_FULL, SEG_BOTTOM, SEG_FULL), CELLS(SEG_NONE, SEG_NONE, SEG_FULL) }, // 4
+    { CELLS(SEG_FULL, SEG_BOTH, SEG_BOTH), CELLS(SEG_BOTTOM, SEG_BOTTOM, SEG_FULL) }, // 5
+    { CELLS(SEG_FULL, SEG_BOTH, SEG_BOTH), CELLS(SEG_FULL, SEG_BOTTOM, SEG_FULL) }, // 6
+    { CELLS(SEG_TOP, SEG_TOP, SEG_FULL), CELLS(SEG_NONE, SEG_NONE, SEG_FULL) }, // 7
+    { CELLS(SEG_FULL, SEG_BOTH, SEG_FULL), CELLS(SEG_FULL, SEG_BOTTOM, SEG_FULL) }, // 8
+    { CELLS(SEG_FULL, SEG_BOTH, SEG_FULL), CELLS(SEG_BOTTOM, SEG_BOTTOM, SEG_FULL) } // 9
+#undef CELLS
+};
+
+// first column of each digit
+static const byte digitColumns[BIG_DIGITS] = { 0, 4, 8, 12 };
+
+LcdBigDigits::LcdBigDigits(LcdFrameBuffer* lcd)
+{
+    _lcd = lcd;
+    _drawn = false;
+}
+
+void LcdBigDigits::drawDigit(byte position, byte digit)
+{
+    for (byte row = 0; row < 2; row++) {
+        uint16_t cells = pgm_read_word(&digitCells[digit][row]);
+        _lcd->setCursor(digitColumns[position], row);
+        for (byte i = 0; i < 3; i++, cells >>= 4) {
+            switch (cells & 0x0F) {
+                case SEG_FULL: _lcd->write((byte)FULL); break;
+                case SEG_TOP: _lcd->write(_lcd->glyph(topBar)); break;
+                case SEG_BOTTOM: _lcd->write(_lcd->glyph(bottomBar)); break;
+                case SEG_BOTH: _lcd->write(_lcd->glyph(bothBars)); break;
+                default: _lcd->write(NOTHING); break;
+            }
+        }
+    }
+    _shown[position] = digit;
+}
+
+boolean LcdBigDigits::drawTime(unsigned long ms)
+{
+    _time.follow(ms);
+    if (_time.digit(0) != 0) return false; // 100 minutes or more
+
+    // something else was drawn over the countdown, or it wasn't up yet
+    if (!_drawn || (_lcd->blanked() != _blanked)) {
+        _lcd->clear();
+        for (byte row = 0; row < 2; row++) {
+            _lcd->setCursor(7, row);
+            _lcd->write((byte)COLON);
+        }
+        for (byte i = 0; i < BIG_DIGITS; i++) _shown[i] = NO_DIGIT;
+        _drawn = true;
+    }
+    for (byte i = 0; i < BIG_DIGITS; i++) {
+        byte digit = _time.digit(i + 1);
+        if (digit != _shown[i]) drawDigit(i, digit);
+    }
+    _blanked = _lcd->blanked();
+    return true;
+}
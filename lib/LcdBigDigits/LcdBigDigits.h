@@ -0,0 +1,59 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  A countdown in digits two rows high, for reading from a distance. Every
+  digit is a block of 2x3 cells drawn from the built-in full block and three
+  custom characters (a bar at the top, at the bottom, at both), which go
+  through the frame buffer's shared CGRAM slots. MM:SS takes 15 columns:
+    col 0-2  3  4-6  7  8-10  11  12-14
+        M       M    :  S         S
+  Only the digits that changed since the last draw are written, so a tick
+  is usually one digit, 6 cells.
+*/
+
+#ifndef LCDBIGDIGITS_H
+#define LCDBIGDIGITS_H
+
+#include <LcdFrameBuffer.h>
+#include <Decimal.h>
+
+#include "Arduino.h"
+
+#define BIG_DIGITS 4 // MM:SS
+
+class LcdBigDigits
+{
+public:
+    LcdBigDigits(LcdFrameBuffer* lcd);
+    /**
+     * Show ms as MM:SS on both rows, rounded down to the second. A screen
+     * that isn't the countdown's yet is cleared first.
+     * Returns false and draws nothing if it is 100 minutes or more.
+     */
+    boolean drawTime(unsigned long ms);
+
+private:
+    void drawDigit(byte position, byte digit);
+
+    LcdFrameBuffer* _lcd;
+    BcdCountdown _time;
+    byte _shown[BIG_DIGITS]; // what each position shows, 0xFF if nothing yet
+    byte _blanked; // of the frame buffer after the last draw
+    boolean _drawn;
+};
+
+#endif
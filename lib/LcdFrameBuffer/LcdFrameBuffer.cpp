@@ -0,0 +1,163 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "LcdFrameBuffer.h"
+
+LcdFrameBuffer::LcdFrameBuffer(LiquidCrystal_I2C* lcd)
+{
+    _lcd = lcd;
+    // lcd.init() leaves the display blank
+    memset(_cells, ' ', sizeof(_cells));
+    _dirty = 0;
+    _col = 0;
+    _row = 0;
+    _lcdAddr = LCD_FB_UNKNOWN_ADDR;
+    _blanked = 0;
+    for (byte i = 0; i < LCD_FB_GLYPHS; i++) {
+        _glyphs[i] = NULL;
+        _glyphUsed[i] = 0;
+    }
+    _glyphClock = 0;
+    _glyphPending = 0;
+}
+
+void LcdFrameBuffer::clear()
+{
+    for (byte i = 0; i < LCD_FB_CELLS; i++) {
+        if (_cells[i] != ' ') {
+            _cells[i] = ' ';
+            _dirty |= (1UL << i);
+        }
+    }
+    _blanked++;
+    _col = 0;
+    _row = 0;
+}
+
+void LcdFrameBuffer::setCursor(byte col, byte row)
+{
+    _col = col;
+    _row = row;
+}
+
+size_t LcdFrameBuffer::write(uint8_t value)
+{
+    if ((_col < LCD_FB_COLS) && (_row < LCD_FB_ROWS)) {
+        byte i = _row * LCD_FB_COLS + _col;
+        if (_cells[i] != (char)value) {
+            _cells[i] = value;
+            _dirty |= (1UL << i);
+        }
+    }
+    _col++;
+    return 1;
+}
+
+byte LcdFrameBuffer::blanked()
+{
+    return _blanked;
+}
+
+void LcdFrameBuffer::createChar(byte location, byte charmap[])
+{
+    _lcd->createChar(location, charmap);
+    // the display is left in CGRAM addressing
+    _lcdAddr = LCD_FB_UNKNOWN_ADDR;
+    _glyphs[location & (LCD_FB_GLYPHS - 1)] = NULL;
+    _glyphPending &= ~(1 << (location & (LCD_FB_GLYPHS - 1)));
+}
+
+byte LcdFrameBuffer::glyph(const byte* charmap)
+{
+    _glyphClock++;
+    for (byte slot = 0; slot < LCD_FB_GLYPHS; slot++) {
+        if (_glyphs[slot] == charmap) {
+            _glyphUsed[slot] = _glyphClock;
+            return slot;
+        }
+    }
+    // a miss: the slots some cell shows can't change
+    byte shown = 0;
+    for (byte i = 0; i < LCD_FB_CELLS; i++) {
+        if ((byte)_cells[i] < LCD_FB_GLYPHS) shown |= (1 << _cells[i]);
+    }
+    byte slot = 0;
+    byte bestRank = 0;
+    byte bestAge = 0;
+    for (byte i = 0; i < LCD_FB_GLYPHS; i++) {
+        // a free slot beats one off the screen, which beats one on it, the oldest between equals
+        // (ages wrap after 256 requests, good enough to tell the stale ones)
+        byte rank = (_glyphs[i] == NULL) ? 2 : ((shown & (1 << i)) ? 0 : 1);
+        byte age = _glyphClock - _glyphUsed[i];
+        if ((i == 0) || (rank > bestRank) || ((rank == bestRank) && (age > bestAge))) {
+            slot = i;
+            bestRank = rank;
+            bestAge = age;
+        }
+    }
+    // uploaded by send(), a full display queue must not stall the caller
+    _glyphs[slot] = charmap;
+    _glyphUsed[slot] = _glyphClock;
+    _glyphPending |= (1 << slot);
+    return slot;
+}
+
+void LcdFrameBuffer::flush()
+{
+    send(true);
+}
+
+void LcdFrameBuffer::update()
+{
+    send(false);
+}
+
+// false if a glyph had to stay pending
+boolean LcdFrameBuffer::sendGlyphs(boolean wait)
+{
+    for (byte slot = 0; _glyphPending != 0; slot++) {
+        if (!(_glyphPending & (1 << slot))) continue;
+        if (!wait && (_lcd->availableForWrite() < LCD_FB_GLYPH_COST)) return false;
+        byte rows[8];
+        memcpy_P(rows, _glyphs[slot], sizeof(rows));
+        _lcd->createChar(slot, rows);
+        // the display is left in CGRAM addressing
+        _lcdAddr = LCD_FB_UNKNOWN_ADDR;
+        _glyphPending &= ~(1 << slot);
+    }
+    return true;
+}
+
+void LcdFrameBuffer::send(boolean wait)
+{
+    if (!sendGlyphs(wait)) return;
+    if (_dirty == 0) return;
+    byte room = wait ? 0xFF : _lcd->availableForWrite();
+    for (byte i = 0; i < LCD_FB_CELLS; i++) {
+        if (!(_dirty & (1UL << i))) continue;
+        byte cost = (_lcdAddr != i) ? 2 : 1;
+        if (cost > room) return;
+        if (!wait) room -= cost;
+        if (_lcdAddr != i) {
+            _lcd->setCursor(i % LCD_FB_COLS, i / LCD_FB_COLS);
+        }
+        _lcd->write(_cells[i]);
+        _dirty &= ~(1UL << i);
+        // the rows are not next to each other in DDRAM
+        _lcdAddr = (((i + 1) % LCD_FB_COLS) == 0) ? LCD_FB_UNKNOWN_ADDR : i + 1;
+    }
+}
@@ -0,0 +1,98 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef LCDFRAMEBUFFER_H
+#define LCDFRAMEBUFFER_H
+
+#include <LiquidCrystal_I2C.h>
+
+#include "Arduino.h"
+
+#define LCD_FB_COLS 16
+#define LCD_FB_ROWS 2
+#define LCD_FB_CELLS (LCD_FB_COLS * LCD_FB_ROWS) // dirty flags are kept in one 32 bit mask
+#define LCD_FB_UNKNOWN_ADDR 0xFF
+#define LCD_FB_GLYPHS 8 // CGRAM slots of the HD44780, character codes 0-7
+#define LCD_FB_GLYPH_COST 9 // queue entries of an upload, the CGRAM address and 8 rows
+
+class LcdFrameBuffer : public Print
+{
+public:
+    /**
+     * Shadow copy of a 16x2 LiquidCrystal_I2C. Everything is drawn into RAM first
+     * and flush() sends only the cells that changed since the last flush.
+     * lcd - An already initialized LiquidCrystal_I2C instance.
+     */
+    LcdFrameBuffer(LiquidCrystal_I2C* lcd);
+    /**
+     * Fill the buffer with spaces. Nothing is sent to the display.
+     */
+    void clear();
+    void setCursor(byte col, byte row);
+    /**
+     * Put a character at the cursor. Characters past the end of a row are dropped,
+     * the display would not show them either.
+     */
+    virtual size_t write(uint8_t value);
+    using Print::write;
+    /**
+     * Upload a custom character. This goes to the display right away.
+     */
+    void createChar(byte location, byte charmap[]);
+    /**
+     * The character code showing charmap, 8 rows of 5 bits in PROGMEM. It is
+     * uploaded only when no slot holds it yet, into a slot none of the cells
+     * shows, the one asked for the longest time ago. That way the bar graph and
+     * the other widgets share the 8 slots. With more than 8 characters on the
+     * screen at once the oldest one is taken anyway and its cells change look.
+     * The upload is sent by the next flush() or update(), ahead of the cells.
+     */
+    byte glyph(const byte* charmap);
+    /**
+     * Send the changed cells, consecutive ones after a single setCursor.
+     * Waits for room in the display queue when there is a lot to send.
+     */
+    void flush();
+    /**
+     * Like flush(), but only queue as many glyphs and cells as fit without waiting.
+     * The rest stay pending for the next call. A glyph that doesn't fit holds the
+     * cells back, so the queue drains and it goes first next time.
+     */
+    void update();
+    /**
+     * Changes every time the buffer is blanked by clear().
+     * Widgets that only redraw what changed use it to tell their cells were wiped.
+     */
+    byte blanked();
+
+private:
+    boolean sendGlyphs(boolean wait);
+    void send(boolean wait);
+
+    LiquidCrystal_I2C* _lcd;
+    char _cells[LCD_FB_CELLS];
+    uint32_t _dirty;
+    byte _col;
+    byte _row;
+    byte _lcdAddr; // cell the display's address counter points at
+    byte _blanked;
+    const byte* _glyphs[LCD_FB_GLYPHS]; // what each slot holds, NULL if unknown
+    byte _glyphUsed[LCD_FB_GLYPHS]; // _glyphClock when it was last asked for
+    byte _glyphClock;
+    byte _glyphPending; // a bit for every slot still to be uploaded
+};
+
+#endif
@@ -0,0 +1,146 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "LcdMenu.h"
+
+LcdMenu::LcdMenu(LcdFrameBuffer* lcd)
+{
+    _lcd = lcd;
+    _screen = NULL;
+    _focus = 0;
+    _typed = 0;
+}
+
+void LcdMenu::show(const MenuScreen* screen, byte focus)
+{
+    _screen = screen;
+    this->focus(focus);
+    draw();
+}
+
+const MenuScreen* LcdMenu::screen()
+{
+    return _screen;
+}
+
+byte LcdMenu::focused()
+{
+    return _focus;
+}
+
+void LcdMenu::focus(byte line)
+{
+    _focus = (line < count()) ? line : count();
+    _typed = 0;
+}
+
+void LcdMenu::moveFocus(boolean forward)
+{
+    byte shownFrom = offset();
+    if (forward) _focus = (_focus < count()) ? (_focus + 1) : 0;
+    else _focus = (_focus > 0) ? (_focus - 1) : count();
+    _typed = 0;
+    if (offset() != shownFrom) {
+        draw();
+        return;
+    }
+    // only the marker moved
+    for (byte row = 0; row < MENU_ROWS; row++) {
+        if (shownFrom + row >= count()) break;
+        _lcd->setCursor(0, row);
+        _lcd->write((shownFrom + row == _focus) ? MENU_FOCUS_SYMBOL : ' ');
+    }
+}
+
+void LcdMenu::select()
+{
+    if (_focus >= count()) return;
+    MenuLine line;
+    readLine(_focus, line);
+    if (line.action != NULL) {
+        line.action();
+    } else if (line.field != NULL) {
+        clearField(line);
+        drawField(line, _focus - offset());
+    }
+}
+
+void LcdMenu::type(char key)
+{
+    if (_focus >= count()) return;
+    MenuLine line;
+    readLine(_focus, line);
+    if (line.field == NULL) return;
+    if ((_typed == 0) || (_typed >= line.fieldSize)) clearField(line);
+    line.field[_typed++] = key;
+    line.field[_typed] = '\0';
+    drawField(line, _focus - offset());
+}
+
+void LcdMenu::draw()
+{
+    byte first = offset();
+    for (byte row = 0; row < MENU_ROWS; row++) drawLine(first + row, row);
+}
+
+void LcdMenu::readLine(byte index, MenuLine& line)
+{
+    const MenuLine* lines = (const MenuLine*)pgm_read_ptr(&_screen->lines);
+    memcpy_P(&line, &lines[index], sizeof(line));
+}
+
+byte LcdMenu::count()
+{
+    return (_screen == NULL) ? 0 : pgm_read_byte(&_screen->count);
+}
+
+// all of it, the code check compares whole buffers and not just up to the terminator
+void LcdMenu::clearField(const MenuLine& line)
+{
+    memset(line.field, 0, line.fieldSize + 1);
+    _typed = 0;
+}
+
+// the first line on screen, so that the focused one is on it
+byte LcdMenu::offset()
+{
+    if ((count() <= MENU_ROWS) || (_focus < MENU_ROWS)) return 0;
+    byte first = _focus - MENU_ROWS + 1;
+    return (first > count() - MENU_ROWS) ? (count() - MENU_ROWS) : first;
+}
+
+void LcdMenu::drawLine(byte index, byte row)
+{
+    _lcd->setCursor(0, row);
+    byte col = 0;
+    if (index < count()) {
+        MenuLine line;
+        readLine(index, line);
+        _lcd->write((index == _focus) ? MENU_FOCUS_SYMBOL : ' ');
+        col = 1 + _lcd->print((const __FlashStringHelper*)line.text);
+        if (line.field != NULL) col += _lcd->print(line.field);
+    }
+    while (col++ < LCD_FB_COLS) _lcd->write(' ');
+}
+
+// the field and the cells it can grow into, the rest of the row stays as it is
+void LcdMenu::drawField(const MenuLine& line, byte row)
+{
+    _lcd->setCursor(1 + strlen_P(line.text), row);
+    byte length = _lcd->print(line.field);
+    while (length++ < line.fieldSize) _lcd->write(' ');
+}
@@ -0,0 +1,101 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  The menu, drawn through the frame buffer. Screens and their lines are
+  const tables in PROGMEM; RAM only holds which screen is up, the focused
+  line and how much of a field was typed. A line is a label, maybe followed
+  by an input field: a string in RAM the digit keys type into, bound to the
+  line by its descriptor. Lines scroll like they did with LiquidMenu: once
+  the focus goes past the second line, it is on the lower row.
+  Typing redraws only the field, moving the focus only the focus column,
+  unless the screen scrolls. The frame buffer then sends the cells that
+  really changed.
+*/
+
+#ifndef LCDMENU_H
+#define LCDMENU_H
+
+#include <LcdFrameBuffer.h>
+
+#include "Arduino.h"
+
+#define MENU_ROWS 2
+#define MENU_FOCUS_SYMBOL '>'
+
+struct MenuLine {
+    const char* text; // in PROGMEM
+    char* field; // typed into, NULL if the line has none
+    byte fieldSize; // characters that fit, the buffer has one more for the terminator
+    void (*action)(); // run by select(), NULL clears the field instead
+};
+
+struct MenuScreen {
+    const MenuLine* lines; // in PROGMEM
+    byte count;
+};
+
+class LcdMenu
+{
+public:
+    LcdMenu(LcdFrameBuffer* lcd);
+    /**
+     * Put screen up with line focus focused. The screen lives in PROGMEM.
+     */
+    void show(const MenuScreen* screen, byte focus);
+    const MenuScreen* screen();
+    /**
+     * The focused line, or the screen's line count when no line is.
+     */
+    byte focused();
+    /**
+     * Move the focus to line without drawing it, draw() does.
+     */
+    void focus(byte line);
+    /**
+     * Focus the next line, or the previous one. As with LiquidMenu, there is
+     * a stop with no line focused between the last line and the first.
+     */
+    void moveFocus(boolean forward);
+    /**
+     * Run the focused line's action, or clear its field if it has none.
+     */
+    void select();
+    /**
+     * Add key to the field of the focused line. Typing into a full field, or into one
+     * just focused, starts it over.
+     */
+    void type(char key);
+    /**
+     * Draw the whole screen again, after something else used the display.
+     */
+    void draw();
+
+private:
+    void readLine(byte index, MenuLine& line);
+    byte count();
+    byte offset();
+    void drawLine(byte index, byte row);
+    void drawField(const MenuLine& line, byte row);
+    void clearField(const MenuLine& line);
+
+    LcdFrameBuffer* _lcd;
+    const MenuScreen* _screen;
+    byte _focus;
+    byte _typed; // characters typed into the focused field since it was focused
+};
+
+#endif
@@ -0,0 +1,260 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "LiquidCrystal_I2C.h"
+
+#define QUEUE_MASK (LCD_QUEUE_SIZE - 1)
+
+// shared with the interrupt. The foreground only moves the head, the interrupt only the tail
+static volatile uint8_t queue[LCD_QUEUE_SIZE];
+static volatile uint8_t queueHead;
+static volatile uint8_t queueTail;
+static volatile bool busBusy;
+static uint8_t busAddress;
+
+static void initBus();
+static void startBus();
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <util/twi.h>
+
+static void initBus() {
+  // internal pull-ups on SDA and SCL, same as Wire does
+  digitalWrite(SDA, HIGH);
+  digitalWrite(SCL, HIGH);
+  TWSR = 0; // prescaler 1
+  TWBR = ((F_CPU / LCD_I2C_CLOCK) - 16) / 2;
+  TWCR = _BV(TWEN);
+}
+
+static void startBus() {
+  uint8_t sreg = SREG;
+  cli();
+  if (!busBusy && (queueHead != queueTail)) {
+    busBusy = true;
+    while (TWCR & _BV(TWSTO)) {} // the last STOP may still be going out
+    TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE) | _BV(TWSTA);
+  }
+  SREG = sreg;
+}
+
+// one transaction runs for as long as there are frames queued
+ISR(TWI_vect) {
+  switch (TW_STATUS) {
+    case TW_START:
+    case TW_REP_START:
+      TWDR = (busAddress << 1) | TW_WRITE;
+      TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+      return;
+    case TW_MT_SLA_ACK:
+    case TW_MT_DATA_ACK:
+      if (queueHead != queueTail) {
+        TWDR = queue[queueTail];
+        queueTail = (queueTail + 1) & QUEUE_MASK;
+        TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWIE);
+        return;
+      }
+      break;
+    default:
+      // NACK or lost arbitration, nobody is there to take the frames
+      queueTail = queueHead;
+      break;
+  }
+  TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+  busBusy = false;
+}
+
+#else
+// host build: the virtual board moves one byte per bus byte time
+#include <SimHal.h>
+
+static bool addressSent;
+
+static void twiInterrupt() {
+  if (!addressSent) {
+    addressSent = true;
+    if (simI2cStart(busAddress)) return;
+    queueTail = queueHead;
+  } else if (queueHead != queueTail) {
+    simI2cSend(queue[queueTail]);
+    queueTail = (queueTail + 1) & QUEUE_MASK;
+    return;
+  }
+  simI2cStop();
+  busBusy = false;
+  simIsrTimer(twiInterrupt, 0);
+}
+
+static void initBus() {
+}
+
+static void startBus() {
+  noInterrupts();
+  if (!busBusy && (queueHead != queueTail)) {
+    busBusy = true;
+    addressSent = false;
+    simIsrTimer(twiInterrupt, SIM_I2C_BYTE_US);
+  }
+  interrupts();
+}
+#endif
+
+//==============================================
+LiquidCrystal_I2C::LiquidCrystal_I2C(uint8_t lcd_Addr, uint8_t lcd_cols, uint8_t lcd_rows) {
+  _Addr = lcd_Addr;
+  _cols = lcd_cols;
+  _rows = lcd_rows;
+  _backlightval = LCD_NOBACKLIGHT;
+  _lastFrame = 0;
+}
+
+void LiquidCrystal_I2C::init() {
+  busAddress = _Addr;
+  initBus();
+  _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+  begin(_cols, _rows);
+}
+
+void LiquidCrystal_I2C::begin(uint8_t cols, uint8_t lines, uint8_t dotsize) {
+  (void)cols;
+  if (lines > 1) _displayfunction |= LCD_2LINE;
+  _numlines = lines;
+  if ((dotsize != 0) && (lines == 1)) _displayfunction |= LCD_5x10DOTS;
+
+  // the controller needs more than 40ms after power up
+  delay(50);
+  pad(1);
+  flush();
+  delay(1000);
+
+  // it may be in 8 bit mode or half way through a 4 bit transfer, the datasheet way to sync is three 0x3 nibbles
+  write4bits(0x03 << 4);
+  flush();
+  delayMicroseconds(4500);
+  write4bits(0x03 << 4);
+  flush();
+  delayMicroseconds(4500);
+  write4bits(0x03 << 4);
+  flush();
+  delayMicroseconds(150);
+  write4bits(0x02 << 4);
+
+  command(LCD_FUNCTIONSET | _displayfunction);
+  _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
+  display();
+  clear();
+  _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+  command(LCD_ENTRYMODESET | _displaymode);
+  home();
+  flush();
+}
+
+void LiquidCrystal_I2C::clear() {
+  command(LCD_CLEARDISPLAY);
+  pad(LCD_SLOW_COMMAND_FRAMES);
+}
+
+void LiquidCrystal_I2C::home() {
+  command(LCD_RETURNHOME);
+  pad(LCD_SLOW_COMMAND_FRAMES);
+}
+
+void LiquidCrystal_I2C::setCursor(uint8_t col, uint8_t row) {
+  static const uint8_t row_offsets[] = { 0x00, 0x40, 0x14, 0x54 };
+  if (row >= _numlines) row = _numlines - 1;
+  command(LCD_SETDDRAMADDR | (col + row_offsets[row]));
+}
+
+void LiquidCrystal_I2C::noDisplay() {
+  _displaycontrol &= ~LCD_DISPLAYON;
+  command(LCD_DISPLAYCONTROL | _displaycontrol);
+}
+
+void LiquidCrystal_I2C::display() {
+  _displaycontrol |= LCD_DISPLAYON;
+  command(LCD_DISPLAYCONTROL | _displaycontrol);
+}
+
+void LiquidCrystal_I2C::createChar(uint8_t location, uint8_t charmap[]) {
+  location &= 0x7;
+  command(LCD_SETCGRAMADDR | (location << 3));
+  for (uint8_t i = 0; i < 8; i++) write(charmap[i]);
+}
+
+void LiquidCrystal_I2C::noBacklight() {
+  _backlightval = LCD_NOBACKLIGHT;
+  pad(1);
+}
+
+void LiquidCrystal_I2C::backlight() {
+  _backlightval = LCD_BACKLIGHT;
+  pad(1);
+}
+
+void LiquidCrystal_I2C::command(uint8_t value) {
+  send(value, 0);
+}
+
+size_t LiquidCrystal_I2C::write(uint8_t value) {
+  send(value, Rs);
+  return 1;
+}
+
+uint8_t LiquidCrystal_I2C::availableForWrite() {
+  uint8_t used = (queueHead - queueTail) & QUEUE_MASK;
+  return (LCD_QUEUE_SIZE - 1 - used) / LCD_FRAMES_PER_BYTE;
+}
+
+void LiquidCrystal_I2C::flush() {
+  while (busBusy || (queueHead != queueTail)) {
+    startBus();
+    yield();
+  }
+}
+
+//==============================================
+void LiquidCrystal_I2C::send(uint8_t value, uint8_t mode) {
+  // RS has to settle before EN goes up, it only needs a frame of its own when it changes
+  if ((_lastFrame & Rs) != mode) push(mode);
+  write4bits((value & 0xF0) | mode);
+  write4bits(((value << 4) & 0xF0) | mode);
+}
+
+// the controller takes the nibble on the falling edge of EN
+void LiquidCrystal_I2C::write4bits(uint8_t value) {
+  push(value | En);
+  push(value);
+}
+
+// frames that change nothing, they only keep the bus busy while the controller works
+void LiquidCrystal_I2C::pad(uint8_t frames) {
+  while (frames--) push(_lastFrame & ~En);
+}
+
+void LiquidCrystal_I2C::push(uint8_t frame) {
+  uint8_t next = (queueHead + 1) & QUEUE_MASK;
+  // back-pressure: wait for the interrupt to make room
+  while (next == queueTail) {
+    startBus();
+    yield();
+  }
+  queue[queueHead] = frame | _backlightval;
+  queueHead = next;
+  _lastFrame = frame;
+  startBus();
+}
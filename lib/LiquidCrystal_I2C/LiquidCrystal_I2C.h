@@ -0,0 +1,126 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  Drop-in replacement for marcoschwartz/LiquidCrystal_I2C, the part of its API
+  the prop uses.
+  Instead of a blocking Wire transfer per PCF8574 write, every HD44780 byte is
+  encoded into expander frames and put into a ring buffer that the TWI
+  interrupt drains in the background. Callers only wait when the ring is full,
+  or when they ask for it with flush().
+*/
+
+#ifndef LiquidCrystal_I2C_h
+#define LiquidCrystal_I2C_h
+
+#include "Arduino.h"
+#include "Print.h"
+
+// commands
+#define LCD_CLEARDISPLAY 0x01
+#define LCD_RETURNHOME 0x02
+#define LCD_ENTRYMODESET 0x04
+#define LCD_DISPLAYCONTROL 0x08
+#define LCD_CURSORSHIFT 0x10
+#define LCD_FUNCTIONSET 0x20
+#define LCD_SETCGRAMADDR 0x40
+#define LCD_SETDDRAMADDR 0x80
+
+// flags for display entry mode
+#define LCD_ENTRYRIGHT 0x00
+#define LCD_ENTRYLEFT 0x02
+#define LCD_ENTRYSHIFTINCREMENT 0x01
+#define LCD_ENTRYSHIFTDECREMENT 0x00
+
+// flags for display on/off control
+#define LCD_DISPLAYON 0x04
+#define LCD_DISPLAYOFF 0x00
+#define LCD_CURSORON 0x02
+#define LCD_CURSOROFF 0x00
+#define LCD_BLINKON 0x01
+#define LCD_BLINKOFF 0x00
+
+// flags for function set
+#define LCD_8BITMODE 0x10
+#define LCD_4BITMODE 0x00
+#define LCD_2LINE 0x08
+#define LCD_1LINE 0x00
+#define LCD_5x10DOTS 0x04
+#define LCD_5x8DOTS 0x00
+
+// flags for backlight control
+#define LCD_BACKLIGHT 0x08
+#define LCD_NOBACKLIGHT 0x00
+
+#define En B00000100 // Enable bit
+#define Rw B00000010 // Read/Write bit
+#define Rs B00000001 // Register select bit
+
+#define LCD_I2C_CLOCK 100000L // the PCF8574 is only specified up to 100kHz
+#define LCD_QUEUE_SIZE 64 // expander frames, must be a power of two
+#define LCD_FRAMES_PER_BYTE 5 // worst case: RS change, then EN high and low for both nibbles
+// clear and home run for 1.52ms, the bus is kept busy with idle frames meanwhile
+#define LCD_SLOW_COMMAND_US 1600
+#define LCD_FRAME_US (9 * 1000000L / LCD_I2C_CLOCK)
+#define LCD_SLOW_COMMAND_FRAMES (LCD_SLOW_COMMAND_US / LCD_FRAME_US + 1)
+
+class LiquidCrystal_I2C : public Print {
+  public:
+    LiquidCrystal_I2C(uint8_t lcd_Addr, uint8_t lcd_cols, uint8_t lcd_rows);
+    void begin(uint8_t cols, uint8_t rows, uint8_t charsize = LCD_5x8DOTS);
+    /**
+     * Set up the TWI peripheral and the display. This one blocks, the controller
+     * needs tens of milliseconds to come up.
+     */
+    void init();
+    void clear();
+    void home();
+    void noDisplay();
+    void display();
+    void noBacklight();
+    void backlight();
+    void createChar(uint8_t location, uint8_t charmap[]);
+    void setCursor(uint8_t col, uint8_t row);
+    virtual size_t write(uint8_t value);
+    using Print::write;
+    void command(uint8_t value);
+    /**
+     * How many characters or commands can be queued right now without waiting.
+     */
+    uint8_t availableForWrite();
+    /**
+     * Wait until everything queued so far has reached the display.
+     */
+    virtual void flush();
+
+  private:
+    void send(uint8_t value, uint8_t mode);
+    void write4bits(uint8_t value);
+    void pad(uint8_t frames);
+    void push(uint8_t frame);
+
+    uint8_t _Addr;
+    uint8_t _displayfunction;
+    uint8_t _displaycontrol;
+    uint8_t _displaymode;
+    uint8_t _numlines;
+    uint8_t _cols;
+    uint8_t _rows;
+    uint8_t _backlightval;
+    uint8_t _lastFrame;
+};
+
+#endif
@@ -0,0 +1,129 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Arduino.h"
+#include "LoopProfiler.h"
+
+#if LOOP_PROFILER
+
+static ProfileCounter counters[LOOP_PROFILER_SECTIONS];
+static unsigned long overhead; // cycles a section with nothing in it measures
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/power.h>
+
+static volatile unsigned int overflows;
+
+static void startClock()
+{
+    power_timer1_enable();
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10); // normal mode, no prescaler
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1);
+    TIMSK1 = _BV(TOIE1);
+}
+
+ISR(TIMER1_OVF_vect)
+{
+    overflows++;
+}
+
+unsigned long LoopProfiler::cycles()
+{
+    uint8_t sreg = SREG;
+    cli();
+    unsigned int high = overflows;
+    unsigned int low = TCNT1;
+    // an overflow that is pending has not been counted yet
+    if ((TIFR1 & _BV(TOV1)) && (low < 0x8000)) high++;
+    SREG = sreg;
+    return ((unsigned long)high << 16) | low;
+}
+
+#else
+// host build: cycles of the virtual clock
+#include <SimHal.h>
+
+static void startClock()
+{
+}
+
+unsigned long LoopProfiler::cycles()
+{
+    return (unsigned long)(simNowMicros() * 16);
+}
+#endif
+
+//==============================================
+void LoopProfiler::begin()
+{
+    startClock();
+    overhead = 0;
+    unsigned long start = cycles();
+    overhead = cycles() - start;
+    reset();
+}
+
+void LoopProfiler::record(byte section, unsigned long cycles)
+{
+    if (section >= LOOP_PROFILER_SECTIONS) return;
+    ProfileCounter& counter = counters[section];
+    cycles = (cycles > overhead) ? (cycles - overhead) : 0;
+    if ((counter.calls == 0) || (cycles < counter.minCycles)) counter.minCycles = cycles;
+    if (cycles > counter.maxCycles) counter.maxCycles = cycles;
+    counter.totalCycles += cycles;
+    counter.calls++;
+}
+
+static void printColumn(Print& out, unsigned long value, byte width)
+{
+    byte digits = 1;
+    for (unsigned long rest = value / 10; rest > 0; rest /= 10) digits++;
+    while (digits++ < width) out.print(' ');
+    out.print(value);
+}
+
+void LoopProfiler::report(Print& out, const char* const* names, byte count)
+{
+    out.println(F("section          calls    min    avg    max cycles"));
+    for (byte i = 0; (i < count) && (i < LOOP_PROFILER_SECTIONS); i++) {
+        const ProfileCounter& counter = counters[i];
+        if (counter.calls == 0) continue;
+        const __FlashStringHelper* name = (const __FlashStringHelper*)pgm_read_ptr(&names[i]);
+        out.print(name);
+        for (byte pad = strlen_P((const char*)name); pad < 12; pad++) out.print(' ');
+        printColumn(out, counter.calls, 10);
+        printColumn(out, counter.minCycles, 7);
+        printColumn(out, (unsigned long)(counter.totalCycles / counter.calls), 7);
+        printColumn(out, counter.maxCycles, 7);
+        out.println();
+    }
+    reset();
+}
+
+void LoopProfiler::reset()
+{
+    for (byte i = 0; i < LOOP_PROFILER_SECTIONS; i++) {
+        counters[i].calls = 0;
+        counters[i].minCycles = 0;
+        counters[i].maxCycles = 0;
+        counters[i].totalCycles = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef LOOPPROFILER_H
+#define LOOPPROFILER_H
+
+#include "Arduino.h"
+
+/*
+  Opt-in profiler: build with -D LOOP_PROFILER=1 to time sections of loop()
+  against Timer1, which runs at the CPU clock. Without the flag the macros
+  below expand to nothing and none of this is compiled.
+  Nested sections are timed inclusively, the outer one counts the inner one too.
+*/
+
+#ifndef LOOP_PROFILER
+#define LOOP_PROFILER 0
+#endif
+
+#if LOOP_PROFILER
+
+#ifndef LOOP_PROFILER_SECTIONS
+#define LOOP_PROFILER_SECTIONS 12
+#endif
+
+struct ProfileCounter {
+    unsigned long calls;
+    unsigned long minCycles;
+    unsigned long maxCycles;
+    unsigned long long totalCycles;
+};
+
+class LoopProfiler
+{
+public:
+    /**
+     * Starts Timer1 and clears the counters. Call after PowerManager::begin(),
+     * which powers Timer1 down. The overflow interrupt wakes the CPU every
+     * 4.096ms, so the awake share goes up while profiling.
+     */
+    static void begin();
+    /**
+     * CPU cycles since begin(), wraps after 268 seconds.
+     */
+    static unsigned long cycles();
+    /**
+     * Adds one run of section that took this many cycles, the cost of timing it taken off.
+     */
+    static void record(byte section, unsigned long cycles);
+    /**
+     * Prints calls and min/avg/max cycles of the sections that ran, then clears the counters.
+     * names holds a PROGMEM string for every section and lives in PROGMEM itself.
+     */
+    static void report(Print& out, const char* const* names, byte count);
+    static void reset();
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(byte section) : _section(section), _start(LoopProfiler::cycles()) {}
+    ~ProfileScope() { LoopProfiler::record(_section, LoopProfiler::cycles() - _start); }
+
+private:
+    byte _section;
+    unsigned long _start;
+};
+
+// times the rest of the enclosing block
+#define PROFILE_SCOPE(section) ProfileScope _profileScope(section)
+// times the statements between the two, both in the same block
+#define PROFILE_START(section) unsigned long _profileStart##section = LoopProfiler::cycles()
+#define PROFILE_STOP(section) LoopProfiler::record(section, LoopProfiler::cycles() - _profileStart##section)
+
+#else
+
+#define PROFILE_SCOPE(section)
+#define PROFILE_START(section)
+#define PROFILE_STOP(section)
+
+#endif
+
+#endif
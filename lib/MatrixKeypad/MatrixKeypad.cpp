@@ -0,0 +1,261 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "MatrixKeypad.h"
+#include <PropPins.h>
+
+static constexpr byte rows = KeypadRowPins::count;
+static constexpr byte cols = KeypadColPins::count;
+
+static_assert(cols <= 8, "a row of the matrix is read into one byte");
+static_assert(!KeypadColPins::usesPort(FastPin<0>::pinReg), "the keypad columns can't be on port D, the team buttons own PCINT2");
+
+// set by the column interrupt, cleared by getKey() once every key is let go
+static volatile boolean scanning;
+
+static void disarm();
+
+// only the columns are watched, and only while the keypad is idle
+static void wake()
+{
+    if (!scanning) {
+        scanning = true;
+        // the scan moves the columns itself, the interrupt stays off until it is done
+        disarm();
+    }
+}
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static const byte colPins[] = { KEYPAD_COL_PINS };
+static byte groups; // PCICR bits of the column pins
+
+static void attachPins()
+{
+    groups = 0;
+    for (byte c = 0; c < cols; c++) {
+        byte pin = colPins[c];
+        *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+        groups |= _BV(digitalPinToPCICRbit(pin));
+    }
+}
+
+static void disarm()
+{
+    PCICR &= ~groups;
+}
+
+static void arm()
+{
+    PCIFR = groups; // edges the scan made itself don't count
+    PCICR |= groups;
+}
+
+ISR(PCINT0_vect)
+{
+    wake();
+}
+
+ISR(PCINT1_vect)
+{
+    wake();
+}
+
+#else
+// host build: the virtual board raises the pin change interrupt when a column moves
+#include <SimHal.h>
+
+static const byte rowPins[] = { KEYPAD_ROW_PINS };
+static const byte colPins[] = { KEYPAD_COL_PINS };
+
+static void attachPins()
+{
+    for (byte c = 0; c < cols; c++) simPinChangeIsr(colPins[c], wake);
+}
+
+// wake() is a no-op while scanning, so the flag does the masking
+static void disarm()
+{
+}
+
+static void arm()
+{
+}
+#endif
+
+//==============================================
+// every row sinks, a key closing pulls its column low
+static void sinkRows()
+{
+    KeypadRowPins::low();
+    KeypadRowPins::output();
+}
+
+MatrixKeypad::MatrixKeypad(const char* keymap)
+{
+    _keymap = keymap;
+    _listener = NULL;
+    _debounceTime = 10;
+    _holdTime = 500;
+    _scanMillis = 0;
+    _holdMillis = 0;
+    for (byte i = 0; i < LIST_MAX; i++) {
+        key[i].kchar = NO_KEY;
+        key[i].kstate = IDLE;
+        key[i].stateChanged = false;
+    }
+#if !defined(__AVR__)
+    // lets the bench press keys by their character
+    simRegisterKeymap(keymap, rowPins, colPins, rows, cols);
+#endif
+}
+
+void MatrixKeypad::begin()
+{
+    noInterrupts();
+    KeypadColPins::inputPullup();
+    sinkRows();
+    attachPins();
+    scanning = false;
+    arm();
+    interrupts();
+    delayMicroseconds(KEYPAD_SETTLE_US);
+    // a key held at power up made no edge
+    if (KeypadColPins::readLow()) wake();
+}
+
+void MatrixKeypad::scan()
+{
+    byte closed[rows];
+    KeypadRowPins::inputPullup();
+    for (byte r = 0; r < rows; r++) {
+        KeypadRowPins::outputLow(r);
+        delayMicroseconds(KEYPAD_SETTLE_US);
+        closed[r] = KeypadColPins::readLow();
+        KeypadRowPins::inputPullup(r);
+    }
+
+    // slots of keys that went back to IDLE are free again
+    for (byte i = 0; i < LIST_MAX; i++) {
+        key[i].stateChanged = false;
+        if (key[i].kstate == IDLE) key[i].kchar = NO_KEY;
+    }
+    for (byte r = 0; r < rows; r++) {
+        for (byte c = 0; c < cols; c++) {
+            boolean down = closed[r] & (1 << c);
+            byte code = r * cols + c;
+            byte index = LIST_MAX;
+            for (byte i = 0; i < LIST_MAX; i++) {
+                if ((key[i].kchar != NO_KEY) && (key[i].kcode == code)) index = i;
+            }
+            if ((index == LIST_MAX) && down) {
+                for (byte i = 0; i < LIST_MAX; i++) {
+                    if (key[i].kchar == NO_KEY) {
+                        key[i].kchar = pgm_read_byte(&_keymap[code]);
+                        key[i].kcode = code;
+                        key[i].kstate = IDLE;
+                        index = i;
+                        break;
+                    }
+                }
+            }
+            if (index < LIST_MAX) nextKeyState(index, down);
+        }
+    }
+}
+
+void MatrixKeypad::nextKeyState(byte index, boolean closed)
+{
+    switch (key[index].kstate) {
+        case IDLE:
+            if (closed) {
+                transitionTo(index, PRESSED);
+                _holdMillis = millis();
+            }
+            break;
+        case PRESSED:
+            if ((millis() - _holdMillis) > _holdTime) transitionTo(index, HOLD);
+            else if (!closed) transitionTo(index, RELEASED);
+            break;
+        case HOLD:
+            if (!closed) transitionTo(index, RELEASED);
+            break;
+        case RELEASED:
+            transitionTo(index, IDLE);
+            break;
+    }
+}
+
+void MatrixKeypad::transitionTo(byte index, KeyState state)
+{
+    key[index].kstate = state;
+    key[index].stateChanged = true;
+    if ((index == 0) && (_listener != NULL)) _listener(key[0].kchar);
+}
+
+char MatrixKeypad::getKey()
+{
+    if (!scanning) return NO_KEY;
+    if ((millis() - _scanMillis) <= _debounceTime) return NO_KEY;
+    _scanMillis = millis();
+    scan();
+
+    boolean anyKey = false;
+    for (byte i = 0; i < LIST_MAX; i++) {
+        if (key[i].kstate != IDLE) anyKey = true;
+    }
+    if (!anyKey) {
+        // back to waiting for an edge, unless a key closed while the rows were let go
+        sinkRows();
+        delayMicroseconds(KEYPAD_SETTLE_US);
+        noInterrupts();
+        scanning = false;
+        arm();
+        if (KeypadColPins::readLow()) wake();
+        interrupts();
+    }
+
+    if (key[0].stateChanged && (key[0].kstate == PRESSED)) return key[0].kchar;
+    return NO_KEY;
+}
+
+KeyState MatrixKeypad::getState()
+{
+    return key[0].kstate;
+}
+
+boolean MatrixKeypad::isIdle()
+{
+    return !scanning;
+}
+
+void MatrixKeypad::setDebounceTime(unsigned int debounceMs)
+{
+    _debounceTime = (debounceMs < 1) ? 1 : debounceMs;
+}
+
+void MatrixKeypad::setHoldTime(unsigned int holdMs)
+{
+    _holdTime = holdMs;
+}
+
+void MatrixKeypad::addEventListener(void (*listener)(char))
+{
+    _listener = listener;
+}
@@ -0,0 +1,89 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef MATRIXKEYPAD_H
+#define MATRIXKEYPAD_H
+
+#include "Arduino.h"
+
+#define LIST_MAX 4 // keys tracked at once
+#define NO_KEY '\0'
+#define KEYPAD_SETTLE_US 10 // for the pulled up columns to rise after a row lets go
+#define makeKeymap(x) ((const char*)x)
+
+typedef char KeypadEvent;
+typedef enum { IDLE, PRESSED, HOLD, RELEASED } KeyState;
+
+struct Key {
+    char kchar; // NO_KEY when the slot is free
+    byte kcode; // row * columns + column
+    KeyState kstate;
+    boolean stateChanged; // by the last scan
+};
+
+class MatrixKeypad
+{
+public:
+    /**
+     * The keypad matrix on the row and column pins from PropPins.h, keymap holds
+     * one character per key, row by row, in PROGMEM.
+     * While no key is down every row sinks and the pin change interrupt on the
+     * columns waits for one to close, so an idle keypad costs nothing and lets
+     * the prop sleep. From the first edge until every key is let go again the
+     * matrix is scanned every debounce time, straight from the port registers.
+     * The columns must not be on port D, PCINT2 belongs to the team buttons.
+     */
+    MatrixKeypad(const char* keymap);
+    void begin();
+    /**
+     * Scan if a key is down and report what changed to the event listener.
+     * Like Keypad::getKey() only the first key in the list makes events, a key
+     * pressed along with it is only seen in key[].
+     * Returns the key that was just pressed, NO_KEY otherwise.
+     */
+    char getKey();
+    /**
+     * State of the key the last event was for.
+     */
+    KeyState getState();
+    /**
+     * No key is down and there is nothing to scan until the columns wake it.
+     */
+    boolean isIdle();
+    void setDebounceTime(unsigned int debounceMs);
+    /**
+     * A key down this long goes to HOLD. The timer starts over whenever another
+     * key goes down, so keys held as a chord reach HOLD in the same scan.
+     */
+    void setHoldTime(unsigned int holdMs);
+    void addEventListener(void (*listener)(char));
+
+    Key key[LIST_MAX];
+
+private:
+    void scan();
+    void nextKeyState(byte index, boolean closed);
+    void transitionTo(byte index, KeyState state);
+
+    const char* _keymap; // in PROGMEM
+    void (*_listener)(char);
+    unsigned int _debounceTime;
+    unsigned int _holdTime;
+    unsigned long _scanMillis;
+    unsigned long _holdMillis;
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "PowerManager.h"
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/sleep.h>
+#include <avr/power.h>
+
+static void powerDownUnused()
+{
+    power_spi_disable();
+    power_timer1_disable();
+    ACSR |= _BV(ACD); // analog comparator
+}
+
+static void idle()
+{
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    noInterrupts();
+    sleep_enable();
+    // the instruction after sei always runs, so no interrupt can slip in before the sleep
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+}
+
+#else
+// host build: the virtual clock jumps to the next interrupt
+#include <SimHal.h>
+
+static void powerDownUnused()
+{
+}
+
+static void idle()
+{
+    simSleep();
+}
+#endif
+
+//==============================================
+PowerManager::PowerManager(LiquidCrystal_I2C* lcd, unsigned long backlightTimeoutMs)
+{
+    _lcd = lcd;
+    _backlightTimeout = backlightTimeoutMs;
+    _activityMillis = 0;
+    _backlightOn = true;
+    _windowMillis = 0;
+    _sleptMillis = 0;
+    _sleptMicros = 0;
+}
+
+void PowerManager::begin()
+{
+    powerDownUnused();
+    _activityMillis = millis();
+    _backlightOn = true;
+    _windowMillis = millis();
+    _sleptMillis = 0;
+    _sleptMicros = 0;
+}
+
+boolean PowerManager::activity()
+{
+    _activityMillis = millis();
+    if (_backlightOn) return false;
+    _lcd->backlight();
+    _backlightOn = true;
+    return true;
+}
+
+void PowerManager::update()
+{
+    if (!_backlightOn || (_backlightTimeout == 0)) return;
+    if ((millis() - _activityMillis) >= _backlightTimeout) {
+        _lcd->noBacklight();
+        _backlightOn = false;
+    }
+}
+
+void PowerManager::sleep()
+{
+    unsigned long started = micros();
+    idle();
+    _sleptMicros += micros() - started;
+    // whole milliseconds move on, a sleep ends with the millis() tick so this runs twice at most
+    while (_sleptMicros >= 1000) {
+        _sleptMicros -= 1000;
+        _sleptMillis++;
+    }
+}
+
+byte PowerManager::awakePercent()
+{
+    unsigned long now = millis();
+    unsigned long hundredth = (now - _windowMillis) / 100;
+    byte percent = 100;
+    if (hundredth > 0) {
+        unsigned long slept = _sleptMillis / hundredth;
+        percent = (slept >= 100) ? 0 : (100 - slept);
+    }
+    _windowMillis = now;
+    _sleptMillis = 0;
+    return percent;
+}
@@ -0,0 +1,70 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+#include <LiquidCrystal_I2C.h>
+
+#include "Arduino.h"
+
+class PowerManager
+{
+public:
+    /**
+     * Sleeps the MCU between interrupts and turns the backlight of lcd off once
+     * nobody has touched the prop for backlightTimeoutMs, 0 keeps it on.
+     * Idle sleep keeps every clock but the CPU's running, so millis(), the sound
+     * timer, the LCD bus and the ADC go on as before and any of their interrupts,
+     * the millis() tick at the latest, wakes the CPU again.
+     */
+    PowerManager(LiquidCrystal_I2C* lcd, unsigned long backlightTimeoutMs);
+    /**
+     * Call after the display is up. Powers down the peripherals the prop never uses.
+     */
+    void begin();
+    /**
+     * A key or team button was used, or something happened worth seeing.
+     * Restarts the backlight timeout and returns true if the backlight was off,
+     * so the caller can swallow the key press that only woke the display.
+     */
+    boolean activity();
+    /**
+     * Turns the backlight off when the timeout ran out. Call once per loop().
+     */
+    void update();
+    /**
+     * Sleep until the next interrupt. Call at the end of loop(), when
+     * everything that was due has been done.
+     */
+    void sleep();
+    /**
+     * Share of time spent awake since the last call or begin(), 0-100.
+     * Good for windows of up to 49 days, when millis() wraps.
+     */
+    byte awakePercent();
+
+private:
+    LiquidCrystal_I2C* _lcd;
+    unsigned long _backlightTimeout;
+    unsigned long _activityMillis;
+    boolean _backlightOn;
+    unsigned long _windowMillis; // when the awake share was last reported
+    unsigned long _sleptMillis; // since then
+    unsigned long _sleptMicros; // the part of a millisecond not in _sleptMillis yet
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Arduino.h"
+#include "PresetStore.h"
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+
+static byte readByte(unsigned int address)
+{
+    return eeprom_read_byte((const uint8_t*)address);
+}
+
+static void writeByte(unsigned int address, byte value)
+{
+    eeprom_write_byte((uint8_t*)address, value);
+}
+
+static boolean ready()
+{
+    return eeprom_is_ready();
+}
+
+#else
+// host build: the EEPROM of the virtual board
+#include <SimHal.h>
+
+static byte readByte(unsigned int address)
+{
+    return simEepromRead(address);
+}
+
+static void writeByte(unsigned int address, byte value)
+{
+    simEepromWrite(address, value);
+}
+
+static boolean ready()
+{
+    return simEepromReady();
+}
+#endif
+
+// CRC-8 with the 0x07 polynomial, seeded so an erased slot doesn't pass
+static byte crc8(const byte* data, byte length)
+{
+    byte crc = 0x5A;
+    for (byte i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (byte bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+//==============================================
+PresetStore::PresetStore(unsigned int start, byte slotSize, byte slots)
+{
+    _start = start;
+    _slotSize = (slotSize > PRESET_MAX_SIZE) ? PRESET_MAX_SIZE : slotSize;
+    _slots = slots;
+    _pendingSlot = 0;
+    _pendingIndex = PRESET_MAX_SIZE + 1;
+}
+
+unsigned int PresetStore::slotAddress(byte slot)
+{
+    return _start + slot * (_slotSize + 1);
+}
+
+boolean PresetStore::load(byte slot, void* data)
+{
+    if (slot >= _slots) return false;
+    byte buffer[PRESET_MAX_SIZE + 1];
+    if ((slot == _pendingSlot) && (_pendingIndex <= _slotSize)) {
+        // not all of it is in the EEPROM yet
+        memcpy(buffer, _pending, _slotSize + 1);
+    } else {
+        // reading waits for a write in progress, a few ms at most
+        unsigned int address = slotAddress(slot);
+        for (byte i = 0; i <= _slotSize; i++) buffer[i] = readByte(address + i);
+    }
+    if (crc8(buffer, _slotSize) != buffer[_slotSize]) return false;
+    memcpy(data, buffer, _slotSize);
+    return true;
+}
+
+void PresetStore::save(byte slot, const void* data)
+{
+    if (slot >= _slots) return;
+    memcpy(_pending, data, _slotSize);
+    _pending[_slotSize] = crc8(_pending, _slotSize);
+    _pendingSlot = slot;
+    _pendingIndex = 0;
+}
+
+void PresetStore::update()
+{
+    if ((_pendingIndex > _slotSize) || !ready()) return;
+    unsigned int address = slotAddress(_pendingSlot);
+    // bytes that already hold the value are skipped, the first one that doesn't gets written
+    while (_pendingIndex <= _slotSize) {
+        byte i = _pendingIndex++;
+        if (readByte(address + i) != _pending[i]) {
+            writeByte(address + i, _pending[i]);
+            return;
+        }
+    }
+}
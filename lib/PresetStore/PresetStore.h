@@ -0,0 +1,60 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef PRESETSTORE_H
+#define PRESETSTORE_H
+
+#include "Arduino.h"
+
+#define PRESET_MAX_SIZE 16 // bytes of a slot, the CRC not included
+
+class PresetStore
+{
+public:
+    /**
+     * slots records of slotSize bytes in EEPROM from address start, each
+     * followed by a CRC-8 of it, so a slot that was never written or lost
+     * power half way through reads as missing rather than as garbage.
+     */
+    PresetStore(unsigned int start, byte slotSize, byte slots);
+    /**
+     * Copies the slot into data. Returns false, leaving data alone,
+     * if the CRC doesn't match.
+     */
+    boolean load(byte slot, void* data);
+    /**
+     * Remembers data for the slot. Nothing is written here: update() writes
+     * the bytes that differ from what the EEPROM holds, so saving the same
+     * values again costs no EEPROM wear at all.
+     * Saving another slot before the last one is written through drops the rest of that one.
+     */
+    void save(byte slot, const void* data);
+    /**
+     * Writes at most one byte, and only when the EEPROM is not busy. Call once per loop().
+     */
+    void update();
+
+private:
+    unsigned int slotAddress(byte slot);
+
+    unsigned int _start;
+    byte _slotSize;
+    byte _slots;
+    byte _pending[PRESET_MAX_SIZE + 1]; // the slot being written, CRC last
+    byte _pendingSlot;
+    byte _pendingIndex; // next byte to compare, past the CRC when there is nothing to write
+};
+
+#endif
@@ -0,0 +1,45 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  How the prop is wired. The sketch and the libraries that drive its
+  hardware from interrupts take their pins from here, so every pin is
+  known at compile time.
+*/
+
+#ifndef PROPPINS_H
+#define PROPPINS_H
+
+#include <FastPin.h>
+
+#define CELL_LED 2
+#define BUZZER_PIN 5
+#define T1_BTN_PIN 6
+#define T2_BTN_PIN 7
+#define SIREN_PIN 8
+#define CELL_PIN 17
+// keypad rows top to bottom and columns left to right
+#define KEYPAD_ROW_PINS 12, 11, 10, 9
+#define KEYPAD_COL_PINS 16, 15, 14, 13
+
+typedef FastPin<CELL_LED> CellLedPin;
+typedef FastPin<BUZZER_PIN> BuzzerPin;
+typedef FastPin<SIREN_PIN> SirenPin;
+typedef FastPinPair<T1_BTN_PIN, T2_BTN_PIN> TeamButtonPins;
+typedef FastPinList<KEYPAD_ROW_PINS> KeypadRowPins;
+typedef FastPinList<KEYPAD_COL_PINS> KeypadColPins;
+
+#endif
@@ -0,0 +1,266 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Arduino.h"
+#include "PropSync.h"
+#include <Timebase.h>
+
+#define MASTER 0
+
+enum SyncFrameType : byte { SYNC_CLOCK, SYNC_START, SYNC_STOP, SYNC_OWNER, SYNC_TELEMETRY, SYNC_FRAME_TYPES };
+
+// payload bytes of each type
+static const byte payloadLengths[SYNC_FRAME_TYPES] PROGMEM = { 4, 9, 0, 1, 14 };
+
+// CRC-8 with the 0x07 polynomial
+static byte crc8(const byte* data, byte length)
+{
+    byte crc = 0;
+    for (byte i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (byte bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void putLong(byte* to, unsigned long value)
+{
+    for (byte i = 0; i < 4; i++, value >>= 8) to[i] = value & 0xFF;
+}
+
+static unsigned long getLong(const byte* from)
+{
+    unsigned long value = 0;
+    for (byte i = 4; i > 0; i--) value = (value << 8) | from[i - 1];
+    return value;
+}
+
+//==============================================
+PropSync::PropSync(HardwareSerial& port, SyncStartHandler onStart, SyncStopHandler onStop, TelemetrySource onTelemetry) : _port(port)
+{
+    _onStart = onStart;
+    _onStop = onStop;
+    _onTelemetry = onTelemetry;
+    _id = PROP_SYNC_OFF;
+    _inGame = false;
+    _frameLength = 0;
+    _frameExpected = 0;
+    _clockError = 0;
+    _telemetryPeriod = 0;
+    _telemetryAt = TIME_UNSET;
+    _telemetrySequence = 0;
+}
+
+void PropSync::begin(byte id)
+{
+    _id = (id < PROP_SYNC_MAX_PROPS) ? id : PROP_SYNC_OFF;
+    for (byte i = 0; i < PROP_SYNC_MAX_PROPS; i++) _owners[i] = PROP_SYNC_NO_OWNER;
+    _frameExpected = 0;
+    _clockAt = TIME_UNSET;
+    _answered = true;
+    _masterHeard = TIME_UNSET;
+    _startPending = false;
+    _stopPending = false;
+}
+
+byte PropSync::id()
+{
+    return _id;
+}
+
+boolean PropSync::isMaster()
+{
+    return _id == MASTER;
+}
+
+boolean PropSync::receive(byte data)
+{
+    if (_id == PROP_SYNC_OFF) return false;
+    if (_frameExpected == 0) {
+        if (data != PROP_SYNC_FRAME_START) return false;
+        _frameLength = 0;
+        _frameExpected = 1; // the type byte says how long the rest is
+        return true;
+    }
+    _frame[_frameLength++] = data;
+    if (_frameLength == 1) {
+        byte type = data >> 4;
+        if (type >= SYNC_FRAME_TYPES) {
+            _frameExpected = 0; // a start byte in the text, or a type this firmware doesn't know
+            return true;
+        }
+        _frameExpected = 1 + pgm_read_byte(&payloadLengths[type]) + 1;
+    }
+    if (_frameLength == _frameExpected) {
+        _frameExpected = 0;
+        if (crc8(_frame, _frameLength - 1) == _frame[_frameLength - 1]) handleFrame();
+    }
+    return true;
+}
+
+void PropSync::handleFrame()
+{
+    byte type = _frame[0] >> 4;
+    byte sender = _frame[0] & 0x0F;
+    const byte* payload = _frame + 1;
+    if ((sender >= PROP_SYNC_MAX_PROPS) || (sender == _id)) return; // our own, heard back from the bus
+    if (type == SYNC_TELEMETRY) return; // for the referee
+    if (type == SYNC_OWNER) {
+        _owners[sender] = payload[0];
+        return;
+    }
+    if ((sender != MASTER) || isMaster()) return;
+    _masterHeard = Timebase::now();
+    switch (type) {
+        case SYNC_CLOCK: {
+            long error = (long)(getLong(payload) + PROP_SYNC_LATENCY - Timebase::now());
+            // a running game must not see its times jump
+            if (_inGame) Timebase::slew(error);
+            else Timebase::step(error);
+            _clockError = error;
+            _clockAt = Timebase::now();
+            _answered = false;
+            break;
+        }
+        case SYNC_START:
+            _start.mode = payload[0];
+            _start.delayMinutes = payload[1] | (payload[2] << 8);
+            _start.gameMinutes = payload[3] | (payload[4] << 8);
+            _start.at = getLong(payload + 5);
+            _onStart(_start);
+            break;
+        case SYNC_STOP:
+            _onStop();
+            break;
+    }
+}
+
+boolean PropSync::send(byte type, const byte* payload, byte length)
+{
+    if (_port.availableForWrite() < 1 + 1 + length + 1) return false;
+    byte frame[1 + PROP_SYNC_PAYLOAD_MAX + 1];
+    frame[0] = (type << 4) | (_id & 0x0F); // 0x0F off the bus
+    for (byte i = 0; i < length; i++) frame[1 + i] = payload[i];
+    frame[1 + length] = crc8(frame, 1 + length);
+    _port.write(PROP_SYNC_FRAME_START);
+    for (byte i = 0; i < 1 + length + 1; i++) _port.write(frame[i]);
+    return true;
+}
+
+void PropSync::update(boolean inGame)
+{
+    _inGame = inGame;
+    if (_id == PROP_SYNC_OFF) {
+        if ((_telemetryPeriod != 0) && Timebase::passed(_telemetryAt, _telemetryPeriod)) sendTelemetry();
+        return;
+    }
+    if (isMaster() && (_startPending || Timebase::passed(_clockAt, PROP_SYNC_CLOCK_PERIOD))) {
+        // a start goes right behind a clock frame, so a prop that just joined has the time for it
+        unsigned long now = Timebase::now();
+        byte payload[PROP_SYNC_PAYLOAD_MAX];
+        putLong(payload, now);
+        if (send(SYNC_CLOCK, payload, 4)) {
+            _clockAt = now;
+            _answered = false;
+            if (_startPending) {
+                payload[0] = _start.mode;
+                payload[1] = _start.delayMinutes & 0xFF;
+                payload[2] = _start.delayMinutes >> 8;
+                payload[3] = _start.gameMinutes & 0xFF;
+                payload[4] = _start.gameMinutes >> 8;
+                putLong(payload + 5, _start.at);
+                if (send(SYNC_START, payload, 9)) _startPending = false;
+            }
+        }
+    }
+    if (isMaster() && _stopPending && send(SYNC_STOP, NULL, 0)) _stopPending = false;
+    if (!_answered && Timebase::passed(_clockAt, (_id + 1) * PROP_SYNC_SLOT)) {
+        _answered = send(SYNC_OWNER, &_owners[_id], 1);
+        // a slot of slack, the slots come a clock period apart give or take a loop() pass
+        if (_answered && (_telemetryPeriod != 0) && Timebase::passed(_telemetryAt, _telemetryPeriod - PROP_SYNC_SLOT)) {
+            sendTelemetry();
+        }
+    }
+}
+
+boolean PropSync::sendTelemetry()
+{
+    Telemetry snapshot;
+    _onTelemetry(snapshot);
+    byte payload[PROP_SYNC_PAYLOAD_MAX];
+    payload[0] = _telemetrySequence;
+    payload[1] = snapshot.mode;
+    payload[2] = snapshot.phase;
+    payload[3] = snapshot.flags;
+    putLong(payload + 4, snapshot.remaining);
+    for (byte team = 0; team < 2; team++) {
+        payload[8 + team * 2] = snapshot.score[team] & 0xFF;
+        payload[9 + team * 2] = snapshot.score[team] >> 8;
+    }
+    payload[12] = snapshot.owner;
+    payload[13] = snapshot.progress;
+    if (!send(SYNC_TELEMETRY, payload, 14)) return false; // tried again on the next pass, or in the next slot
+    _telemetrySequence++;
+    _telemetryAt = Timebase::now();
+    return true;
+}
+
+void PropSync::sendStart(const SyncStart& start)
+{
+    if (!isMaster()) return;
+    _start = start;
+    _startPending = true;
+    _stopPending = false;
+}
+
+void PropSync::sendStop()
+{
+    if (!isMaster()) return;
+    _stopPending = true;
+    _startPending = false;
+}
+
+void PropSync::setOwner(byte team)
+{
+    if (_id != PROP_SYNC_OFF) _owners[_id] = team;
+}
+
+byte PropSync::owner(byte prop)
+{
+    return (prop < PROP_SYNC_MAX_PROPS) ? _owners[prop] : PROP_SYNC_NO_OWNER;
+}
+
+long PropSync::clockError()
+{
+    return _clockError;
+}
+
+void PropSync::setTelemetryPeriod(unsigned int period)
+{
+    _telemetryPeriod = ((period != 0) && (period < PROP_SYNC_MIN_TELEMETRY)) ? PROP_SYNC_MIN_TELEMETRY : period;
+}
+
+unsigned int PropSync::telemetryPeriod()
+{
+    return _telemetryPeriod;
+}
+
+boolean PropSync::hearsMaster()
+{
+    if (isMaster()) return true;
+    return (_masterHeard != TIME_UNSET) && !Timebase::passed(_masterHeard, PROP_SYNC_TIMEOUT);
+}
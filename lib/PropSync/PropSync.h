@@ -0,0 +1,159 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef PROPSYNC_H
+#define PROPSYNC_H
+
+#include "Arduino.h"
+
+/*
+  Several props on one UART bus (RS-485 transceivers with automatic
+  direction, or plain TTL with one talker), one of them the master.
+  The master sends its game clock every PROP_SYNC_CLOCK_PERIOD and the others
+  pull their Timebase onto it, so timed games start and end on the same
+  millisecond everywhere. Games started or stopped on the master are
+  started or stopped on every prop, and each prop tells the others which
+  team holds its point.
+  After every clock frame prop n gets slot n+1 to talk in, so frames don't collide.
+  A prop can also send telemetry, snapshots of its game for a referee's
+  laptop listening on the bus: in its slot, or at its own rate when it is
+  off the bus and the laptop is all that is on the port.
+
+  A frame is PROP_SYNC_FRAME_START, type << 4 | sender, a payload whose length
+  depends on the type, then a CRC-8 over the type byte and the payload.
+  Numbers go least significant byte first. Anything between frames is left
+  to the text commands that share the port.
+  The port's RX and TX buffers are filled and drained by interrupts, and
+  nothing here waits for room in them.
+*/
+
+#define PROP_SYNC_MAX_PROPS 8 // ids 0-7, 0 is the master
+#define PROP_SYNC_OFF 0xFF // an id that keeps the prop off the bus
+#define PROP_SYNC_NO_OWNER 0xFF
+#define PROP_SYNC_FRAME_START 0x7E
+#define PROP_SYNC_PAYLOAD_MAX 14 // telemetry
+#define PROP_SYNC_CLOCK_PERIOD 500 // ms between clock frames of the master
+#define PROP_SYNC_SLOT 40 // ms
+#define PROP_SYNC_LATENCY 1 // ms from the master reading its clock to a prop taking it: 7 bytes at 115200 baud and a loop() pass
+#define PROP_SYNC_TIMEOUT 2000 // the master is gone when nothing came from it for this long
+#define PROP_SYNC_MIN_TELEMETRY 50 // ms, the shortest telemetry period
+// bits of Telemetry::flags
+#define TELEMETRY_RUNNING 0x01 // the game runs, it didn't end yet
+#define TELEMETRY_SIREN 0x02
+#define TELEMETRY_T1_HELD 0x04
+#define TELEMETRY_T2_HELD 0x08
+
+struct SyncStart {
+    byte mode;
+    unsigned int delayMinutes;
+    unsigned int gameMinutes;
+    unsigned long at; // start of the game on the shared clock
+};
+
+/*
+  A telemetry frame is a sequence number that counts the snapshots, so a
+  listener can tell it missed some, then these fields in this order.
+*/
+struct Telemetry {
+    byte mode; // GAME_NONE in the menu
+    byte phase; // the mode's own state
+    byte flags;
+    unsigned long remaining; // ms left of the running phase, 0 if it has no end
+    unsigned int score[2];
+    byte owner; // team holding the point, PROP_SYNC_NO_OWNER for none
+    byte progress; // of a capture, arming or disarming, 0-255
+};
+
+typedef void (*SyncStartHandler)(const SyncStart& start);
+typedef void (*SyncStopHandler)();
+typedef void (*TelemetrySource)(Telemetry& snapshot);
+
+class PropSync
+{
+public:
+    /**
+     * onStart and onStop are called on the other props when the master
+     * starts or stops a game. onTelemetry fills in a snapshot when one is due.
+     */
+    PropSync(HardwareSerial& port, SyncStartHandler onStart, SyncStopHandler onStop, TelemetrySource onTelemetry);
+    /**
+     * Joins the bus as prop id, the master if 0. PROP_SYNC_OFF leaves it.
+     */
+    void begin(byte id);
+    byte id();
+    boolean isMaster();
+    /**
+     * Every byte read from the port has to go through here first.
+     * Returns false if it is no part of a frame, for the text commands.
+     */
+    boolean receive(byte data);
+    /**
+     * Sends whatever is due. Call once per loop(). While inGame the clock is
+     * slewed onto the master's, otherwise it is stepped.
+     */
+    void update(boolean inGame);
+    /**
+     * The master sends these, nobody else does. The frame goes out from update().
+     */
+    void sendStart(const SyncStart& start);
+    void sendStop();
+    /**
+     * The team holding this prop's point, PROP_SYNC_NO_OWNER for none.
+     */
+    void setOwner(byte team);
+    /**
+     * The team holding the point of prop id, as last heard.
+     */
+    byte owner(byte prop);
+    /**
+     * ms the clock was behind the master's at the last clock frame.
+     */
+    long clockError();
+    boolean hearsMaster();
+    /**
+     * ms between telemetry snapshots, 0 for none. On the bus they go out in
+     * the prop's slot, so no more often than the clock frames.
+     */
+    void setTelemetryPeriod(unsigned int period);
+    unsigned int telemetryPeriod();
+
+private:
+    void handleFrame();
+    boolean send(byte type, const byte* payload, byte length);
+    boolean sendTelemetry();
+
+    HardwareSerial& _port;
+    SyncStartHandler _onStart;
+    SyncStopHandler _onStop;
+    TelemetrySource _onTelemetry;
+    byte _id;
+    boolean _inGame;
+    byte _frame[1 + PROP_SYNC_PAYLOAD_MAX + 1]; // type byte, payload, CRC
+    byte _frameLength; // bytes of _frame received, 0 while waiting for a start
+    byte _frameExpected;
+    byte _owners[PROP_SYNC_MAX_PROPS];
+    unsigned long _clockAt; // when the last clock frame came in or went out
+    boolean _answered; // this prop's slot after it was used
+    long _clockError;
+    unsigned long _masterHeard;
+    SyncStart _start;
+    boolean _startPending;
+    boolean _stopPending;
+    unsigned int _telemetryPeriod;
+    unsigned long _telemetryAt; // when the last snapshot went out
+    byte _telemetrySequence;
+};
+
+#endif
@@ -0,0 +1,196 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "SoundSequencer.h"
+#include <PropPins.h>
+
+struct SoundChannel {
+    const SoundStep* step; // NULL when the channel is quiet
+    long leftUs; // of the current step
+};
+
+// owned by the interrupt while a pattern plays
+static volatile SoundChannel buzzer;
+static volatile SoundChannel siren;
+static volatile uint16_t tickUs;
+
+static void startTimer(uint16_t frequency);
+static void stopTimer();
+
+static uint16_t stepFrequency(const SoundStep* step)
+{
+    return pgm_read_word(&step->frequency);
+}
+
+static uint16_t stepDuration(const SoundStep* step)
+{
+    return pgm_read_word(&step->duration);
+}
+
+// the buzzer is toggled on every tick, so its step sets the timer rate
+static void retime()
+{
+    if (buzzer.step != NULL) {
+        startTimer(stepFrequency(buzzer.step));
+    } else if (siren.step != NULL) {
+        startTimer(0);
+    } else {
+        stopTimer();
+    }
+}
+
+static void startStep(volatile SoundChannel& channel, const SoundStep* step)
+{
+    if (stepDuration(step) == 0) {
+        channel.step = NULL;
+    } else {
+        channel.step = step;
+        // the overshoot of the previous step is taken off this one, so patterns keep in time
+        channel.leftUs += stepDuration(step) * 1000L;
+    }
+}
+
+static void soundInterrupt()
+{
+    boolean buzzerChanged = false;
+    if (buzzer.step != NULL) {
+        if (stepFrequency(buzzer.step) != 0) BuzzerPin::toggle();
+        buzzer.leftUs -= tickUs;
+        if (buzzer.leftUs <= 0) {
+            startStep(buzzer, buzzer.step + 1);
+            BuzzerPin::low();
+            buzzerChanged = true;
+        }
+    }
+    if (siren.step != NULL) {
+        siren.leftUs -= tickUs;
+        if (siren.leftUs <= 0) {
+            startStep(siren, siren.step + 1);
+            SirenPin::write((siren.step != NULL) && (stepFrequency(siren.step) != 0));
+            if (buzzer.step == NULL) buzzerChanged = true;
+        }
+    }
+    if (buzzerChanged) retime();
+}
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+// Timer2 in CTC mode, the slowest prescaler that fits the half period into 8 bits
+static void startTimer(uint16_t frequency)
+{
+    static const uint16_t prescalers[] = { 1, 8, 32, 64, 128, 256, 1024 };
+    unsigned long ticks = frequency ? (F_CPU / 2 / frequency) : (F_CPU / 1000000L * SOUND_TICK_US);
+    byte i = 0;
+    while ((i < 6) && ((ticks / prescalers[i]) > 256)) i++;
+    uint16_t ocr = ticks / prescalers[i];
+    if (ocr > 256) ocr = 256;
+    tickUs = (unsigned long)ocr * prescalers[i] / (F_CPU / 1000000L);
+    TCCR2A = _BV(WGM21);
+    TCCR2B = i + 1; // CS22:0 count up with the table
+    OCR2A = ocr - 1;
+    TCNT2 = 0;
+    TIMSK2 = _BV(OCIE2A);
+}
+
+static void stopTimer()
+{
+    TIMSK2 = 0;
+}
+
+ISR(TIMER2_COMPA_vect)
+{
+    soundInterrupt();
+}
+
+#else
+// host build: the virtual board calls the handler at the timer rate
+#include <SimHal.h>
+
+static void startTimer(uint16_t frequency)
+{
+    tickUs = frequency ? (500000L / frequency) : SOUND_TICK_US;
+    simIsrTimer(soundInterrupt, tickUs);
+}
+
+static void stopTimer()
+{
+    simIsrTimer(soundInterrupt, 0);
+}
+#endif
+
+//==============================================
+SoundSequencer::SoundSequencer()
+{
+}
+
+void SoundSequencer::begin()
+{
+    BuzzerPin::output();
+    SirenPin::output();
+    stop();
+    stopSiren();
+}
+
+void SoundSequencer::play(const SoundStep* pattern)
+{
+    noInterrupts();
+    buzzer.leftUs = 0;
+    startStep(buzzer, pattern);
+    BuzzerPin::low();
+    retime();
+    interrupts();
+}
+
+void SoundSequencer::playSiren(const SoundStep* pattern)
+{
+    noInterrupts();
+    siren.leftUs = 0;
+    startStep(siren, pattern);
+    SirenPin::write((siren.step != NULL) && (stepFrequency(siren.step) != 0));
+    if (buzzer.step == NULL) retime();
+    interrupts();
+}
+
+void SoundSequencer::stop()
+{
+    noInterrupts();
+    buzzer.step = NULL;
+    BuzzerPin::low();
+    retime();
+    interrupts();
+}
+
+void SoundSequencer::stopSiren()
+{
+    noInterrupts();
+    siren.step = NULL;
+    SirenPin::low();
+    if (buzzer.step == NULL) retime();
+    interrupts();
+}
+
+boolean SoundSequencer::isPlaying()
+{
+    return buzzer.step != NULL;
+}
+
+boolean SoundSequencer::isSirenPlaying()
+{
+    return siren.step != NULL;
+}
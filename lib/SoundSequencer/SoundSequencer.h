@@ -0,0 +1,60 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef SOUNDSEQUENCER_H
+#define SOUNDSEQUENCER_H
+
+#include "Arduino.h"
+
+#define SOUND_TICK_US 1000 // timer period while the buzzer is quiet
+#define SIREN_ON 1 // any frequency switches the siren on, it has no pitch of its own
+#define SOUND_END { 0, 0 }
+
+/**
+ * One step of a pattern. Patterns are arrays of these in PROGMEM, closed with SOUND_END.
+ * frequency - Hz on the buzzer, 0 for a pause.
+ * duration - ms, up to 65535.
+ */
+struct SoundStep {
+    uint16_t frequency;
+    uint16_t duration;
+};
+
+class SoundSequencer
+{
+public:
+    /**
+     * Plays patterns on the buzzer and the siren (pins from PropPins.h) from the
+     * Timer2 compare interrupt, so their timing does not depend on how long loop() takes.
+     * Timer2 is the one tone() uses, so tone() must not be used next to this.
+     */
+    SoundSequencer();
+    void begin();
+    /**
+     * Start a pattern on the buzzer, cutting off whatever it was playing.
+     */
+    void play(const SoundStep* pattern);
+    /**
+     * Start a pattern on the siren, a pause keeps it off.
+     */
+    void playSiren(const SoundStep* pattern);
+    void stop();
+    void stopSiren();
+    boolean isPlaying();
+    boolean isSirenPlaying();
+};
+
+#endif
@@ -0,0 +1,83 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "TaskQueue.h"
+#include <Timebase.h>
+
+TaskQueue::TaskQueue()
+{
+    for (byte i = 0; i < TASK_QUEUE_SIZE; i++) {
+        _tasks[i].callback = NULL;
+    }
+}
+
+bool TaskQueue::add(TaskCallback callback, unsigned long delayMs, unsigned long periodMs)
+{
+    for (byte i = 0; i < TASK_QUEUE_SIZE; i++) {
+        if (_tasks[i].callback == NULL) {
+            _tasks[i].callback = callback;
+            _tasks[i].due = Timebase::now() + delayMs;
+            _tasks[i].period = periodMs;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskQueue::runLater(TaskCallback callback, unsigned long delayMs)
+{
+    return add(callback, delayMs, 0);
+}
+
+bool TaskQueue::runEvery(TaskCallback callback, unsigned long periodMs)
+{
+    return add(callback, periodMs, periodMs);
+}
+
+void TaskQueue::cancel(TaskCallback callback)
+{
+    for (byte i = 0; i < TASK_QUEUE_SIZE; i++) {
+        if (_tasks[i].callback == callback) _tasks[i].callback = NULL;
+    }
+}
+
+boolean TaskQueue::isPending(TaskCallback callback)
+{
+    for (byte i = 0; i < TASK_QUEUE_SIZE; i++) {
+        if (_tasks[i].callback == callback) return true;
+    }
+    return false;
+}
+
+void TaskQueue::run()
+{
+    unsigned long now = Timebase::now();
+    for (byte i = 0; i < TASK_QUEUE_SIZE; i++) {
+        TaskCallback callback = _tasks[i].callback;
+        // the signed difference keeps working when the clock rolls over
+        if ((callback == NULL) || ((long)(now - _tasks[i].due) < 0)) continue;
+        if (_tasks[i].period > 0) {
+            _tasks[i].due += _tasks[i].period;
+            // don't try to catch up on periods missed while something else was slow
+            if ((long)(now - _tasks[i].due) >= 0) _tasks[i].due = now + _tasks[i].period;
+        } else {
+            // free the slot first, the callback may want to schedule again
+            _tasks[i].callback = NULL;
+        }
+        callback();
+    }
+}
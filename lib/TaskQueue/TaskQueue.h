@@ -0,0 +1,61 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TASKQUEUE_H
+#define TASKQUEUE_H
+
+#include "Arduino.h"
+
+#define TASK_QUEUE_SIZE 6
+
+typedef void (*TaskCallback)(void);
+
+class TaskQueue
+{
+public:
+    TaskQueue();
+    /**
+     * Call callback once, delayMs from now.
+     * Returns false if every slot is taken.
+     */
+    bool runLater(TaskCallback callback, unsigned long delayMs);
+    /**
+     * Call callback every periodMs, the first time periodMs from now.
+     * Returns false if every slot is taken.
+     */
+    bool runEvery(TaskCallback callback, unsigned long periodMs);
+    /**
+     * Drop every pending call of callback.
+     */
+    void cancel(TaskCallback callback);
+    boolean isPending(TaskCallback callback);
+    /**
+     * Call everything that is due. Call this once per loop().
+     */
+    void run();
+
+private:
+    bool add(TaskCallback callback, unsigned long delayMs, unsigned long periodMs);
+
+    struct Task {
+        TaskCallback callback;
+        unsigned long due;
+        unsigned long period; // 0 for one-shot tasks
+    };
+    Task _tasks[TASK_QUEUE_SIZE];
+};
+
+#endif
@@ -0,0 +1,122 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "TeamButtons.h"
+#include <PropPins.h>
+#include <Timebase.h>
+
+#define QUEUE_MASK (BUTTON_EVENT_QUEUE_SIZE - 1)
+
+static_assert(FastPin<T1_BTN_PIN>::pinReg == FastPin<0>::pinReg, "the team buttons must be on port D, the PCINT2 port");
+
+// written by the interrupt, and by read() with interrupts off
+static ButtonEvent queue[BUTTON_EVENT_QUEUE_SIZE];
+static volatile byte queueHead;
+static volatile byte queueTail;
+static volatile boolean pressed[TEAM_BUTTONS];
+static volatile unsigned long changedMillis[TEAM_BUTTONS];
+
+static void push(byte button, ButtonEventType type, unsigned long time)
+{
+    byte next = (queueHead + 1) & QUEUE_MASK;
+    if (next == queueTail) return; // loop() stopped reading, the newest edge is lost
+    queue[queueHead].button = button;
+    queue[queueHead].type = type;
+    queue[queueHead].time = time;
+    queueHead = next;
+}
+
+// runs with interrupts off
+static void sampleButtons()
+{
+    unsigned long now = Timebase::now();
+    byte downBits = TeamButtonPins::readLow(); // both in one read, so two edges at once are seen together
+    for (byte i = 0; i < TEAM_BUTTONS; i++) {
+        boolean down = downBits & (1 << i);
+        if (down == pressed[i]) continue;
+        // the first edge is taken as it comes, the bouncing after it is not.
+        // Whatever level the contacts settle on is picked up by the next edge or read()
+        if ((now - changedMillis[i]) < BUTTON_DEBOUNCE_TIME) continue;
+        pressed[i] = down;
+        changedMillis[i] = now;
+        push(i, down ? BUTTON_PRESSED : BUTTON_RELEASED, now);
+    }
+}
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+static void attachPin(byte pin)
+{
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    PCICR |= _BV(digitalPinToPCICRbit(pin));
+}
+
+ISR(PCINT2_vect)
+{
+    sampleButtons();
+}
+
+#else
+// host build: the virtual board raises the pin change interrupt when a button moves
+#include <SimHal.h>
+
+static void attachPin(byte pin)
+{
+    simPinChangeIsr(pin, sampleButtons);
+}
+#endif
+
+//==============================================
+TeamButtons::TeamButtons()
+{
+}
+
+void TeamButtons::begin()
+{
+    noInterrupts();
+    TeamButtonPins::inputPullup();
+    attachPin(T1_BTN_PIN);
+    attachPin(T2_BTN_PIN);
+    // a button held at power up counts as pressed, but makes no event
+    byte downBits = TeamButtonPins::readLow();
+    for (byte i = 0; i < TEAM_BUTTONS; i++) {
+        pressed[i] = downBits & (1 << i);
+        changedMillis[i] = Timebase::now();
+    }
+    queueHead = queueTail;
+    interrupts();
+}
+
+bool TeamButtons::read(ButtonEvent& event)
+{
+    noInterrupts();
+    sampleButtons(); // a level that settled after the bouncing fired no edge of its own
+    bool available = (queueHead != queueTail);
+    if (available) {
+        event = queue[queueTail];
+        queueTail = (queueTail + 1) & QUEUE_MASK;
+    }
+    interrupts();
+    return available;
+}
+
+boolean TeamButtons::isPressed(byte button)
+{
+    return pressed[button];
+}
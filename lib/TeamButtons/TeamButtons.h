@@ -0,0 +1,55 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef TEAMBUTTONS_H
+#define TEAMBUTTONS_H
+
+#include "Arduino.h"
+
+#define TEAM_BUTTONS 2
+#define BUTTON_EVENT_QUEUE_SIZE 8 // must be a power of two
+#define BUTTON_DEBOUNCE_TIME 20 // edges this soon after an accepted one are contact bounce
+
+typedef enum { BUTTON_PRESSED, BUTTON_RELEASED } ButtonEventType;
+
+struct ButtonEvent {
+    byte button; // 0 for team 1, 1 for team 2
+    ButtonEventType type;
+    unsigned long time; // Timebase::now() when it happened
+};
+
+class TeamButtons
+{
+public:
+    /**
+     * The two team buttons (pins from PropPins.h), caught by the pin change interrupt as they happen.
+     * Every debounced press and release is queued with its Timebase::now() timestamp,
+     * so hold times don't depend on how often loop() gets to look.
+     * Both pins must be on port D (digital 0-7), this owns the PCINT2 vector.
+     */
+    TeamButtons();
+    void begin();
+    /**
+     * Take the oldest event from the queue. Returns false when there is none.
+     */
+    bool read(ButtonEvent& event);
+    /**
+     * Debounced state right now, events still in the queue included.
+     */
+    boolean isPressed(byte button);
+};
+
+#endif
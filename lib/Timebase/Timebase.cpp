@@ -0,0 +1,115 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#include "Arduino.h"
+#include "Timebase.h"
+
+#define PPM 1000000L
+#define TIMEBASE_STEP 60000UL // ms of drift worked out at once, TIMEBASE_MAX_DRIFT times it fits a long
+
+static int driftPpm;
+// written by now() with interrupts off
+static unsigned long lastRaw;
+static unsigned long corrected;
+static long owed; // ppm-milliseconds of drift not taken off yet, less than a millisecond's worth
+static long slewing; // ms still to be put on (or taken off) the clock
+
+//==============================================
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+
+#define LOCK() uint8_t sreg = SREG; cli()
+#define UNLOCK() SREG = sreg
+
+#else
+// host build: interrupts only run inside millis(), before the state is looked at
+#define LOCK()
+#define UNLOCK()
+#endif
+
+//==============================================
+void Timebase::setDrift(int ppm)
+{
+    if (ppm > TIMEBASE_MAX_DRIFT) ppm = TIMEBASE_MAX_DRIFT;
+    if (ppm < -TIMEBASE_MAX_DRIFT) ppm = -TIMEBASE_MAX_DRIFT;
+    now(); // the time so far goes at the old rate
+    driftPpm = ppm;
+}
+
+int Timebase::drift()
+{
+    return driftPpm;
+}
+
+void Timebase::step(long ms)
+{
+    LOCK();
+    corrected += ms;
+    slewing = 0;
+    UNLOCK();
+}
+
+void Timebase::slew(long ms)
+{
+    LOCK();
+    slewing = ms;
+    UNLOCK();
+}
+
+unsigned long Timebase::now()
+{
+    LOCK();
+    unsigned long raw = millis();
+    unsigned long passed = raw - lastRaw;
+    lastRaw = raw;
+    unsigned long before = corrected;
+    corrected += passed;
+    while (passed > 0) {
+        unsigned long step = (passed > TIMEBASE_STEP) ? TIMEBASE_STEP : passed;
+        passed -= step;
+        owed += (long)step * driftPpm;
+        // a fast board counted milliseconds that didn't happen
+        if ((owed >= PPM) || (owed <= -PPM)) {
+            corrected -= owed / PPM;
+            owed %= PPM;
+        }
+    }
+    if (slewing != 0) {
+        // at most as much as the clock moved, so going back only ever stops it
+        long moved = corrected - before;
+        long amount = (slewing > moved) ? moved : ((slewing < -moved) ? -moved : slewing);
+        corrected += amount;
+        slewing -= amount;
+    }
+    unsigned long time = corrected;
+    UNLOCK();
+    // a millisecond late once every 49 days
+    return (time == TIME_UNSET) ? time + 1 : time;
+}
+
+unsigned long Timebase::since(unsigned long time)
+{
+    return now() - time;
+}
+
+boolean Timebase::passed(unsigned long time, unsigned long ms)
+{
+    return (time == TIME_UNSET) || (since(time) >= ms);
+}
+
+boolean Timebase::reached(unsigned long deadline)
+{
+    return (long)(now() - deadline) >= 0;
+}
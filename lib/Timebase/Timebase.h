@@ -0,0 +1,74 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+#include "Arduino.h"
+
+/*
+  The game clock: millis() with the drift of the board's resonator taken off.
+  Cheap ceramic resonators are off by up to 0.5%, which is 18 seconds in an
+  hour long game. The drift of a unit is measured once against a watch and
+  kept in EEPROM, see setDrift().
+  Times are 32-bit milliseconds that roll over after 49 days. Only the
+  difference of two of them means anything, and since() and reached() get it
+  right across the roll over. now() never returns TIME_UNSET, so a variable
+  holding it is a time that hasn't been taken yet.
+*/
+
+#define TIME_UNSET 0
+#define TIMEBASE_MAX_DRIFT 20000 // ppm, setDrift() clamps to this
+
+class Timebase
+{
+public:
+    /**
+     * ppm is how much faster than real time the board runs: +100 when it
+     * counts an hour and 0.36 seconds while a watch counts an hour.
+     */
+    static void setDrift(int ppm);
+    static int drift();
+    /**
+     * Moves the clock by ms at once, to follow another clock. Times taken
+     * before can end up in the future, so only while no game runs.
+     */
+    static void step(long ms);
+    /**
+     * Moves the clock by ms a millisecond per millisecond: it runs twice as
+     * fast or stands still until it is there, but never goes back.
+     * Replaces what is left of the last slew().
+     */
+    static void slew(long ms);
+    /**
+     * Milliseconds on the corrected clock. Safe to call from interrupts.
+     * Call at least every 70 seconds, loop() does so many times over.
+     */
+    static unsigned long now();
+    /**
+     * Milliseconds from time to now(), as long as that is under 49 days.
+     */
+    static unsigned long since(unsigned long time);
+    /**
+     * True once ms passed since time, or if time is TIME_UNSET.
+     */
+    static boolean passed(unsigned long time, unsigned long ms);
+    /**
+     * True once now() got to deadline, for deadlines less than 24 days away.
+     */
+    static boolean reached(unsigned long deadline);
+};
+
+#endif
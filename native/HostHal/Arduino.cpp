@@ -0,0 +1,94 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Arduino.h"
+#include "SimHal.h"
+
+void pinMode(uint8_t pin, uint8_t mode) {
+  simAdvance(SIM_COST_PIN_MODE);
+  simPinMode(pin, mode);
+}
+
+void digitalWrite(uint8_t pin, uint8_t val) {
+  simAdvance(SIM_COST_DIGITAL_WRITE);
+  simWritePin(pin, val);
+}
+
+int digitalRead(uint8_t pin) {
+  simAdvance(SIM_COST_DIGITAL_READ);
+  return simReadPin(pin);
+}
+
+int analogRead(uint8_t pin) {
+  simAdvance(SIM_COST_ANALOG_READ);
+  return simReadAnalog(pin);
+}
+
+unsigned long millis(void) {
+  simAdvance(SIM_COST_MILLIS);
+  return (unsigned long)(simNowMicros() / 1000);
+}
+
+unsigned long micros(void) {
+  simAdvance(SIM_COST_MILLIS);
+  return (unsigned long)simNowMicros();
+}
+
+void delay(unsigned long ms) {
+  simAdvance(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  simAdvance(us);
+}
+
+char* itoa(int value, char* s, int radix) {
+  char digits[sizeof(int) * 8 + 1];
+  unsigned int rest = (value < 0) && (radix == 10) ? -(unsigned int)value : (unsigned int)value;
+  uint8_t count = 0;
+  do {
+    uint8_t digit = rest % radix;
+    digits[count++] = (digit < 10) ? ('0' + digit) : ('a' + digit - 10);
+    rest /= radix;
+  } while (rest > 0);
+  char* out = s;
+  if ((value < 0) && (radix == 10)) *out++ = '-';
+  while (count > 0) *out++ = digits[--count];
+  *out = '\0';
+  return s;
+}
+
+void tone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+  simAdvance(SIM_COST_TONE);
+  simTone(pin, frequency, duration);
+}
+
+void noTone(uint8_t pin) {
+  simAdvance(SIM_COST_TONE);
+  simNoTone(pin);
+}
+
+void yield(void) {
+  simAdvance(1);
+}
+
+void interrupts(void) {
+  simInterrupts(true);
+}
+
+void noInterrupts(void) {
+  simInterrupts(false);
+}
@@ -0,0 +1,33 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "HardwareSerial.h"
+#include "SimHal.h"
+
+HardwareSerial Serial;
+
+int HardwareSerial::available() {
+  return simSerialAvailable();
+}
+
+int HardwareSerial::read() {
+  return simSerialRead();
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  simSerialSend(c);
+  return 1;
+}
@@ -0,0 +1,539 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SimHal.h"
+
+#define LCD_ADDRESS 0x27
+// PCF8574 lines as wired on the common LCD backpacks
+#define PCF_RS 0x01
+#define PCF_EN 0x04
+#define PCF_BACKLIGHT 0x08
+
+struct SimPin {
+  uint8_t mode;
+  uint8_t out;
+  bool driven; // pulled by a button from outside
+  uint8_t drivenLevel;
+};
+
+struct SimSwitch {
+  uint8_t a;
+  uint8_t b;
+};
+
+struct SimI2cSlot {
+  uint8_t address;
+  SimI2cDevice* device;
+};
+
+struct SimIsrSlot {
+  SimIsr isr;
+  uint32_t period;
+  uint64_t due;
+};
+
+struct SimPinChangeSlot {
+  uint8_t pin;
+  SimIsr isr;
+  uint8_t level; // last level the interrupt saw
+  bool pending;
+};
+
+SimStats simStats;
+SimLcd simLcd;
+
+static uint64_t nowUs;
+static SimPin pins[SIM_NUM_PINS];
+static SimSwitch switches[SIM_MAX_SWITCHES];
+static uint8_t switchCount;
+static uint16_t analogLevels[SIM_NUM_PINS];
+static SimI2cSlot i2cDevices[SIM_MAX_I2C_DEVICES];
+static uint8_t i2cDeviceCount;
+static SimI2cDevice* i2cActive;
+static SimIsrSlot isrs[SIM_MAX_ISRS];
+static SimPinChangeSlot pinChangeIsrs[SIM_MAX_PIN_CHANGE_ISRS];
+static uint8_t pinChangeIsrCount;
+static bool interruptsEnabled;
+static bool inIsr;
+// simAdvance() runs every few simulated microseconds, these let it skip the slot scans
+static uint64_t nextDue; // earliest due time of the timer interrupts
+static bool pinChangePending;
+
+static const char* keymapChars;
+static uint8_t keymapRowPins[8];
+static uint8_t keymapColPins[8];
+static uint8_t keymapRows;
+static uint8_t keymapCols;
+static SimPinWatch pinWatch;
+
+static uint8_t eeprom[SIM_EEPROM_SIZE];
+static bool eepromErased; // a new chip comes erased
+static uint64_t eepromBusyUntil;
+
+static char serialRx[SIM_SERIAL_RX_SIZE];
+static uint8_t serialRxHead;
+static uint8_t serialRxCount;
+static SimSerialSink serialSink;
+
+//==============================================
+SimLcd::SimLcd() {
+  reset();
+}
+
+void SimLcd::reset() {
+  memset(_ddram, ' ', sizeof(_ddram));
+  memset(_cgram, 0, sizeof(_cgram));
+  _addr = 0;
+  _cgramMode = false;
+  _fourBit = false; // HD44780 powers up in 8 bit mode
+  _haveHighNibble = false;
+  _highNibble = 0;
+  _lastPort = 0;
+  _backlight = false;
+}
+
+void SimLcd::i2cWrite(uint8_t data) {
+  // the controller samples the data lines on the falling edge of EN
+  if ((_lastPort & PCF_EN) && !(data & PCF_EN)) {
+    latchNibble(_lastPort >> 4, _lastPort & PCF_RS);
+  }
+  _backlight = (data & PCF_BACKLIGHT);
+  _lastPort = data;
+}
+
+void SimLcd::latchNibble(uint8_t nibble, bool rs) {
+  if (!_fourBit) {
+    // only D4-D7 are wired, so in 8 bit mode the low half reads as zeros
+    execute(nibble << 4, rs);
+  } else if (!_haveHighNibble) {
+    _highNibble = nibble;
+    _haveHighNibble = true;
+  } else {
+    _haveHighNibble = false;
+    execute((_highNibble << 4) | nibble, rs);
+  }
+}
+
+void SimLcd::execute(uint8_t value, bool rs) {
+  if (rs) {
+    if (_cgramMode) {
+      _cgram[_addr & 0x3F] = value;
+      _addr = (_addr + 1) & 0x3F;
+    } else {
+      _ddram[_addr & 0x7F] = value;
+      _addr++;
+      // two line mode: 0x00-0x27 and 0x40-0x67, each wrapping into the other
+      if (_addr == 0x28) _addr = 0x40;
+      else if (_addr == 0x68) _addr = 0x00;
+    }
+    return;
+  }
+  if (value & 0x80) { // set DDRAM address
+    _addr = value & 0x7F;
+    _cgramMode = false;
+  } else if (value & 0x40) { // set CGRAM address
+    _addr = value & 0x3F;
+    _cgramMode = true;
+  } else if (value & 0x20) { // function set
+    bool fourBit = !(value & 0x10);
+    if (fourBit && !_fourBit) _haveHighNibble = false;
+    _fourBit = fourBit;
+  } else if (value & 0x10) { // cursor/display shift, not used by the prop
+  } else if (value & 0x08) { // display on/off
+  } else if (value & 0x04) { // entry mode, the prop only uses left to right
+  } else if (value & 0x02) { // return home
+    _addr = 0;
+    _cgramMode = false;
+  } else if (value & 0x01) { // clear display
+    memset(_ddram, ' ', sizeof(_ddram));
+    _addr = 0;
+    _cgramMode = false;
+  }
+}
+
+void SimLcd::rowText(uint8_t row, char* out) const {
+  memcpy(out, &_ddram[row ? 0x40 : 0x00], 16);
+  out[16] = '\0';
+}
+
+// custom characters move between slots as the widgets share them, so transcripts
+// show what one looks like instead of its slot: a bar of 1-4 columns from the left as
+// '1'-'4', from the right as 'a'-'d', a full block as '#', bars across the top, the
+// bottom or both as '^', '_' and '=', anything else as '?'
+char SimLcd::glyphShape(uint8_t slot) const {
+  const uint8_t* rows = &_cgram[slot * 8];
+  uint8_t filled = 0; // a bit per row that is all on
+  bool acrossOnly = true; // every row is either all on or all off
+  bool columnsOnly = true; // every row is the same
+  for (uint8_t i = 0; i < 8; i++) {
+    uint8_t row = rows[i] & 0x1F;
+    if (row == 0x1F) filled |= (1 << i);
+    else if (row != 0) acrossOnly = false;
+    if (row != (rows[0] & 0x1F)) columnsOnly = false;
+  }
+  if (acrossOnly && !columnsOnly) {
+    if ((filled & 0xF0) == 0) return '^';
+    if ((filled & 0x0F) == 0) return '_';
+    return '=';
+  }
+  if (!columnsOnly) return '?';
+  uint8_t bits = rows[0] & 0x1F;
+  if (bits == 0x1F) return '#';
+  for (uint8_t k = 1; k <= 4; k++) {
+    if (bits == ((0x1F << (5 - k)) & 0x1F)) return '0' + k;
+    if (bits == ((1 << k) - 1)) return 'a' + k - 1;
+  }
+  return '?';
+}
+
+void SimLcd::rowShown(uint8_t row, char* out) const {
+  rowText(row, out);
+  for (uint8_t i = 0; i < 16; i++) {
+    uint8_t c = out[i];
+    if (c < 8) out[i] = glyphShape(c);
+    else if (c == 0xFF) out[i] = '#';
+    else if (c == 0xA5) out[i] = '.'; // the dot in the middle of the cell
+    else if ((c < 0x20) || (c > 0x7E)) out[i] = '?';
+  }
+}
+
+//==============================================
+void simReset() {
+  nowUs = 0;
+  memset(&simStats, 0, sizeof(simStats));
+  for (uint8_t i = 0; i < SIM_NUM_PINS; i++) {
+    pins[i].mode = INPUT;
+    pins[i].out = LOW;
+    pins[i].driven = false;
+    pins[i].drivenLevel = LOW;
+  }
+  switchCount = 0;
+  memset(analogLevels, 0, sizeof(analogLevels));
+  i2cDeviceCount = 0;
+  i2cActive = NULL;
+  memset(isrs, 0, sizeof(isrs));
+  pinChangeIsrCount = 0;
+  nextDue = UINT64_MAX;
+  pinChangePending = false;
+  interruptsEnabled = true;
+  inIsr = false;
+  simLcd.reset();
+  simI2cAttach(LCD_ADDRESS, &simLcd);
+  if (!eepromErased) {
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    eepromErased = true;
+  }
+  eepromBusyUntil = 0;
+  serialRxHead = 0;
+  serialRxCount = 0;
+}
+
+uint64_t simNowMicros() {
+  return nowUs;
+}
+
+static void findNextDue() {
+  nextDue = UINT64_MAX;
+  for (uint8_t i = 0; i < SIM_MAX_ISRS; i++) {
+    if ((isrs[i].isr != NULL) && (isrs[i].due < nextDue)) nextDue = isrs[i].due;
+  }
+}
+
+void simAdvance(uint32_t us) {
+  uint64_t target = nowUs + us;
+  if (inIsr || !interruptsEnabled || (!pinChangePending && (target < nextDue))) {
+    nowUs = target;
+    return;
+  }
+  inIsr = true;
+  // pin changes are flagged the moment they happen, so they go first
+  pinChangePending = false;
+  for (uint8_t i = 0; i < pinChangeIsrCount; i++) {
+    if (pinChangeIsrs[i].pending) {
+      pinChangeIsrs[i].pending = false;
+      pinChangeIsrs[i].isr();
+    }
+  }
+  for (;;) {
+    SimIsrSlot* next = NULL;
+    for (uint8_t i = 0; i < SIM_MAX_ISRS; i++) {
+      if ((isrs[i].isr != NULL) && (isrs[i].due <= target) && ((next == NULL) || (isrs[i].due < next->due))) {
+        next = &isrs[i];
+      }
+    }
+    if (next == NULL) break;
+    if (next->due > nowUs) nowUs = next->due;
+    next->due += next->period;
+    next->isr();
+    findNextDue();
+  }
+  nowUs = target;
+  inIsr = false;
+}
+
+void simIsrTimer(SimIsr isr, uint32_t periodUs) {
+  SimIsrSlot* free = NULL;
+  for (uint8_t i = 0; i < SIM_MAX_ISRS; i++) {
+    if (isrs[i].isr == isr) {
+      free = &isrs[i];
+      break;
+    }
+    if ((free == NULL) && (isrs[i].isr == NULL)) free = &isrs[i];
+  }
+  if (free == NULL) return;
+  if (periodUs == 0) {
+    free->isr = NULL;
+    findNextDue();
+    return;
+  }
+  // keep the phase when only the period changes
+  if (free->isr != isr) free->due = nowUs + periodUs;
+  free->isr = isr;
+  free->period = periodUs;
+  findNextDue();
+}
+
+void simPinChangeIsr(uint8_t pin, SimIsr isr) {
+  if (pinChangeIsrCount >= SIM_MAX_PIN_CHANGE_ISRS) return;
+  SimPinChangeSlot& slot = pinChangeIsrs[pinChangeIsrCount++];
+  slot.pin = pin;
+  slot.isr = isr;
+  slot.level = simReadPin(pin);
+  slot.pending = false;
+}
+
+// called after anything moved a pin, the sketch included
+static void checkPinChanges() {
+  bool changed = false;
+  for (uint8_t i = 0; i < pinChangeIsrCount; i++) {
+    uint8_t level = simReadPin(pinChangeIsrs[i].pin);
+    if (level != pinChangeIsrs[i].level) {
+      pinChangeIsrs[i].level = level;
+      pinChangeIsrs[i].pending = true;
+      pinChangePending = true;
+      changed = true;
+    }
+  }
+  if (changed) simAdvance(0);
+}
+
+void simInterrupts(bool enabled) {
+  interruptsEnabled = enabled;
+  // whatever fell due while they were off runs now
+  if (enabled) simAdvance(0);
+}
+
+void simSleep() {
+  uint64_t wake = (nowUs / SIM_TIMER0_OVERFLOW_US + 1) * SIM_TIMER0_OVERFLOW_US;
+  if (nextDue < wake) wake = nextDue;
+  if (wake <= nowUs) return;
+  simStats.sleptUs += wake - nowUs;
+  simAdvance(wake - nowUs);
+}
+
+//==============================================
+void simPinMode(uint8_t pin, uint8_t mode) {
+  if (pin >= SIM_NUM_PINS) return;
+  pins[pin].mode = mode;
+  // like on the AVR, INPUT_PULLUP leaves the port latch high
+  if (mode == INPUT_PULLUP) pins[pin].out = HIGH;
+  checkPinChanges();
+}
+
+void simWritePin(uint8_t pin, uint8_t level) {
+  if (pin >= SIM_NUM_PINS) return;
+  level = level ? HIGH : LOW;
+  bool changed = (level != pins[pin].out);
+  pins[pin].out = level;
+  if (changed && (pinWatch != NULL)) pinWatch(pin, level);
+  simStats.pinWrites++;
+  checkPinChanges();
+}
+
+uint8_t simReadPin(uint8_t pin) {
+  if (pin >= SIM_NUM_PINS) return LOW;
+  const SimPin& p = pins[pin];
+  if (p.mode == OUTPUT) return p.out;
+  if (p.driven) return p.drivenLevel;
+  // a closed key connects this pin to whatever drives the other side
+  for (uint8_t i = 0; i < switchCount; i++) {
+    uint8_t other;
+    if (switches[i].a == pin) other = switches[i].b;
+    else if (switches[i].b == pin) other = switches[i].a;
+    else continue;
+    if (pins[other].mode == OUTPUT) return pins[other].out;
+  }
+  return (p.mode == INPUT_PULLUP) ? HIGH : LOW;
+}
+
+uint8_t simPinLevel(uint8_t pin) {
+  if (pin >= SIM_NUM_PINS) return LOW;
+  return pins[pin].out;
+}
+
+void simWatchPins(SimPinWatch watch) {
+  pinWatch = watch;
+}
+
+//==============================================
+void simSetButton(uint8_t pin, bool pressed) {
+  if (pin >= SIM_NUM_PINS) return;
+  // buttons short the pin to ground
+  pins[pin].driven = pressed;
+  pins[pin].drivenLevel = LOW;
+  checkPinChanges();
+}
+
+void simSetAnalog(uint8_t pin, uint16_t value) {
+  if (pin >= SIM_NUM_PINS) return;
+  analogLevels[pin] = (value > 1023) ? 1023 : value;
+}
+
+uint16_t simReadAnalog(uint8_t pin) {
+  if (pin >= SIM_NUM_PINS) return 0;
+  return analogLevels[pin];
+}
+
+void simRegisterKeymap(const char* keymap, const uint8_t* rowPins, const uint8_t* colPins, uint8_t rows, uint8_t cols) {
+  keymapChars = keymap;
+  keymapRows = rows;
+  keymapCols = cols;
+  memcpy(keymapRowPins, rowPins, rows);
+  memcpy(keymapColPins, colPins, cols);
+}
+
+bool simSetKey(char key, bool pressed) {
+  if (keymapChars == NULL) return false;
+  for (uint8_t r = 0; r < keymapRows; r++) {
+    for (uint8_t c = 0; c < keymapCols; c++) {
+      if (keymapChars[r * keymapCols + c] != key) continue;
+      uint8_t a = keymapRowPins[r];
+      uint8_t b = keymapColPins[c];
+      bool found = false;
+      for (uint8_t i = 0; i < switchCount; i++) {
+        if ((switches[i].a == a) && (switches[i].b == b)) {
+          if (!pressed) switches[i] = switches[--switchCount];
+          found = true;
+          break;
+        }
+      }
+      if (pressed && !found && (switchCount < SIM_MAX_SWITCHES)) {
+        switches[switchCount].a = a;
+        switches[switchCount].b = b;
+        switchCount++;
+      }
+      checkPinChanges();
+      return true;
+    }
+  }
+  return false;
+}
+
+//==============================================
+void simTone(uint8_t pin, unsigned int frequency, unsigned long duration) {
+  (void)pin;
+  (void)frequency;
+  (void)duration;
+  simStats.tones++;
+}
+
+void simNoTone(uint8_t pin) {
+  (void)pin;
+}
+
+//==============================================
+uint8_t simEepromRead(uint16_t address) {
+  return eeprom[address % SIM_EEPROM_SIZE];
+}
+
+void simEepromWrite(uint16_t address, uint8_t value) {
+  eeprom[address % SIM_EEPROM_SIZE] = value;
+  eepromBusyUntil = nowUs + SIM_EEPROM_WRITE_US;
+  simStats.eepromWrites++;
+}
+
+bool simEepromReady() {
+  return nowUs >= eepromBusyUntil;
+}
+
+//==============================================
+void simSerialReceive(const char* text) {
+  simSerialReceiveBytes((const uint8_t*)text, strlen(text));
+}
+
+// like the UART's RX buffer, what doesn't fit is lost
+void simSerialReceiveBytes(const uint8_t* data, uint16_t length) {
+  for (; (length > 0) && (serialRxCount < SIM_SERIAL_RX_SIZE); data++, length--) {
+    serialRx[(serialRxHead + serialRxCount) % SIM_SERIAL_RX_SIZE] = *data;
+    serialRxCount++;
+  }
+}
+
+void simSerialSink(SimSerialSink sink) {
+  serialSink = sink;
+}
+
+void simSerialSend(uint8_t data) {
+  if (serialSink != NULL) serialSink(data);
+  else putchar(data);
+}
+
+int simSerialAvailable() {
+  return serialRxCount;
+}
+
+int simSerialRead() {
+  if (serialRxCount == 0) return -1;
+  char c = serialRx[serialRxHead];
+  serialRxHead = (serialRxHead + 1) % SIM_SERIAL_RX_SIZE;
+  serialRxCount--;
+  return (uint8_t)c;
+}
+
+//==============================================
+void simI2cAttach(uint8_t address, SimI2cDevice* device) {
+  if (i2cDeviceCount >= SIM_MAX_I2C_DEVICES) return;
+  i2cDevices[i2cDeviceCount].address = address;
+  i2cDevices[i2cDeviceCount].device = device;
+  i2cDeviceCount++;
+}
+
+bool simI2cStart(uint8_t address) {
+  simStats.i2cTransactions++;
+  i2cActive = NULL;
+  for (uint8_t i = 0; i < i2cDeviceCount; i++) {
+    if (i2cDevices[i].address == address) {
+      i2cActive = i2cDevices[i].device;
+      i2cActive->i2cStart();
+      return true;
+    }
+  }
+  return false;
+}
+
+void simI2cSend(uint8_t data) {
+  if (i2cActive == NULL) return;
+  i2cActive->i2cWrite(data);
+  simStats.i2cBytes++;
+}
+
+void simI2cStop() {
+  if (i2cActive != NULL) i2cActive->i2cStop();
+  i2cActive = NULL;
+}
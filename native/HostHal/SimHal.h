@@ -0,0 +1,157 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  Virtual board behind the host stand-ins: a deterministic microsecond clock,
+  the pin states of the prop, the I2C bus with the PCF8574 LCD backpack on it
+  and the counters the bench reports.
+  Nothing here touches the wall clock, so every run gives the same numbers.
+*/
+
+#ifndef SimHal_h
+#define SimHal_h
+
+#include <stdint.h>
+
+#define SIM_NUM_PINS 20
+#define SIM_MAX_SWITCHES 8
+#define SIM_MAX_I2C_DEVICES 4
+#define SIM_MAX_ISRS 6
+#define SIM_MAX_PIN_CHANGE_ISRS 8
+
+// rough cost of core calls on a 16MHz ATmega328P, in microseconds
+#define SIM_COST_LOOP 2
+#define SIM_COST_MILLIS 1
+#define SIM_COST_DIGITAL_READ 4
+#define SIM_COST_DIGITAL_WRITE 4
+#define SIM_COST_PIN_MODE 4
+#define SIM_COST_ANALOG_READ 112
+#define SIM_COST_TONE 12
+// Timer0 overflows every 256 * 64 clocks for millis(), that interrupt ends any sleep
+#define SIM_TIMER0_OVERFLOW_US 1024
+// 100kHz bus: every byte is 9 clocks
+#define SIM_I2C_CLOCK_US 10
+#define SIM_I2C_BYTE_CLOCKS 9
+#define SIM_I2C_BYTE_US (SIM_I2C_BYTE_CLOCKS * SIM_I2C_CLOCK_US)
+#define SIM_EEPROM_SIZE 1024
+// erase and write of one byte, the CPU goes on meanwhile
+#define SIM_EEPROM_WRITE_US 3400
+#define SIM_SERIAL_RX_SIZE 64
+
+class SimI2cDevice {
+  public:
+    virtual ~SimI2cDevice() {}
+    virtual void i2cStart() {}
+    virtual void i2cWrite(uint8_t data) = 0;
+    virtual void i2cStop() {}
+};
+
+// HD44780 behind a PCF8574, decoded from the bytes the expander receives
+class SimLcd : public SimI2cDevice {
+  public:
+    SimLcd();
+    void reset();
+    void i2cWrite(uint8_t data);
+    // copies a 16 character row of DDRAM into out, which must hold 17 chars
+    void rowText(uint8_t row, char* out) const;
+    // the same row as it looks, printable: custom characters by their shape (see glyphShape()),
+    // the built-in block as '#', the middle dot as '.', anything else outside ASCII as '?'
+    void rowShown(uint8_t row, char* out) const;
+    bool backlight() const { return _backlight; }
+
+  private:
+    char glyphShape(uint8_t slot) const;
+    void latchNibble(uint8_t nibble, bool rs);
+    void execute(uint8_t value, bool rs);
+
+    char _ddram[0x80];
+    uint8_t _cgram[64];
+    uint8_t _addr;
+    bool _cgramMode;
+    bool _fourBit;
+    bool _haveHighNibble;
+    uint8_t _highNibble;
+    uint8_t _lastPort;
+    bool _backlight;
+};
+
+struct SimStats {
+  uint32_t i2cBytes; // data bytes, address bytes not included
+  uint32_t i2cTransactions;
+  uint32_t tones;
+  uint32_t pinWrites;
+  uint32_t eepromWrites;
+  uint64_t sleptUs;
+};
+
+extern SimStats simStats;
+extern SimLcd simLcd;
+
+typedef void (*SimIsr)(void);
+
+void simReset();
+uint64_t simNowMicros();
+// moves the clock forward, running the interrupt handlers that fall due on the way
+void simAdvance(uint32_t us);
+// a stand-in for a peripheral interrupt: isr runs every periodUs of virtual time, 0 stops it
+void simIsrTimer(SimIsr isr, uint32_t periodUs);
+void simInterrupts(bool enabled);
+// idle sleep: the clock jumps to the next interrupt, the millis() tick at the latest
+void simSleep();
+// a stand-in for a pin change interrupt: isr runs whenever the level read from pin changes
+void simPinChangeIsr(uint8_t pin, SimIsr isr);
+
+// pins as the sketch sees them
+void simPinMode(uint8_t pin, uint8_t mode);
+void simWritePin(uint8_t pin, uint8_t level);
+uint8_t simReadPin(uint8_t pin);
+uint8_t simPinLevel(uint8_t pin); // last level the sketch wrote
+// called whenever the sketch changes the level of an output, NULL for nobody
+typedef void (*SimPinWatch)(uint8_t pin, uint8_t level);
+void simWatchPins(SimPinWatch watch);
+
+// outside world
+void simSetButton(uint8_t pin, bool pressed);
+void simSetAnalog(uint8_t pin, uint16_t value); // 0-1023
+uint16_t simReadAnalog(uint8_t pin);
+void simRegisterKeymap(const char* keymap, const uint8_t* rowPins, const uint8_t* colPins, uint8_t rows, uint8_t cols);
+bool simSetKey(char key, bool pressed);
+
+void simTone(uint8_t pin, unsigned int frequency, unsigned long duration);
+void simNoTone(uint8_t pin);
+
+// the EEPROM keeps its contents over simReset(), like the chip does over a reset
+uint8_t simEepromRead(uint16_t address);
+void simEepromWrite(uint16_t address, uint8_t value); // only when simEepromReady()
+bool simEepromReady();
+
+// bytes arriving on the UART, read back through Serial
+void simSerialReceive(const char* text);
+void simSerialReceiveBytes(const uint8_t* data, uint16_t length);
+// bytes the sketch sends go to sink, stdout when it is NULL
+typedef void (*SimSerialSink)(uint8_t data);
+void simSerialSink(SimSerialSink sink);
+void simSerialSend(uint8_t data);
+int simSerialAvailable();
+int simSerialRead(); // -1 when there is nothing
+
+void simI2cAttach(uint8_t address, SimI2cDevice* device);
+// byte by byte transfer for interrupt driven masters, these take no time by themselves
+bool simI2cStart(uint8_t address); // false on NACK
+void simI2cSend(uint8_t data);
+void simI2cStop();
+
+#endif
@@ -0,0 +1,70 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+// no Arduino.h, its B0, B110... clash with the baud rates of termios.h
+#include "SimHal.h"
+#include "sim_bus.h"
+
+static int busFd = -1;
+static unsigned int busSpeed;
+static uint64_t virtualStartUs;
+static uint64_t wallStartUs;
+
+static uint64_t wallMicros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void sendToBus(uint8_t data) {
+  // a terminal takes what a UART at 115200 baud can send, nothing is lost
+  while (write(busFd, &data, 1) != 1) usleep(100);
+}
+
+bool busOpen(const char* path, unsigned int speed) {
+  busFd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (busFd < 0) return false;
+  // bytes as they are, no echo or line editing
+  struct termios raw;
+  if (tcgetattr(busFd, &raw) == 0) {
+    cfmakeraw(&raw);
+    tcsetattr(busFd, TCSANOW, &raw);
+  }
+  busSpeed = (speed > 0) ? speed : 1;
+  virtualStartUs = simNowMicros();
+  wallStartUs = wallMicros();
+  simSerialSink(sendToBus);
+  return true;
+}
+
+bool busIsOpen() {
+  return busFd >= 0;
+}
+
+void busPoll() {
+  uint64_t virtualUs = simNowMicros() - virtualStartUs;
+  uint64_t wallUs = (wallMicros() - wallStartUs) * busSpeed;
+  if (virtualUs > wallUs) usleep((virtualUs - wallUs) / busSpeed);
+  uint8_t data[SIM_SERIAL_RX_SIZE];
+  int room = SIM_SERIAL_RX_SIZE - simSerialAvailable();
+  if (room <= 0) return;
+  ssize_t got = read(busFd, data, room);
+  if (got > 0) simSerialReceiveBytes(data, got);
+}
@@ -0,0 +1,32 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+  Puts a simulated prop on a bus with others, each one its own process: the
+  UART goes to a pseudo-terminal that native/sim_bus.py joins with the
+  terminals of the other props. The virtual clocks can't be shared between
+  processes, so each one is held back to run at the speed of the wall clock.
+*/
+
+#ifndef sim_bus_h
+#define sim_bus_h
+
+// false if the terminal can't be opened. speed is virtual time per wall time
+bool busOpen(const char* path, unsigned int speed);
+bool busIsOpen();
+// moves the bytes that came from the bus to the UART and waits for the wall clock, once per loop() pass
+void busPoll();
+
+#endif
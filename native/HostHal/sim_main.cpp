@@ -0,0 +1,231 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+
+/*
+  Host bench for the prop. Boots the real setup(), walks every game mode
+  through the menu with simulated key presses and team buttons, and prints
+  for each phase how many loop() passes fit into a simulated second, how many
+  I2C data bytes went to the LCD, the longest single loop() pass and the
+  share of time the MCU was awake rather than sleeping between interrupts,
+  as PowerManager::awakePercent() reports it and as the simulator counted it.
+
+  It fails when a single loop() pass took longer than MAX_LOOP_US: the
+  display and the EEPROM are written in the background, nothing the prop
+  does may wait for them.
+
+  Usage: program [-v]    -v also prints the LCD contents after every phase
+                         and the event log at the end
+         program -s file  plays the scenario script in file instead, see sim_scenario.cpp
+         program -u tty [-x speed] -s file
+                          the same with the UART on a bus with other props, see sim_bus.h
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "Arduino.h"
+#include "SimHal.h"
+#include "sim_scenario.h"
+#include "sim_bus.h"
+#include <PowerManager.h>
+
+#define T1_BTN 6
+#define T2_BTN 7
+#define CELL_PIN 17
+#define CELL_HEALTHY 917 // 3.9V on the prop's divider
+#define KEY_TAP_TIME 100
+#define MAX_LOOP_US 500 // the keypad and the buttons are polled at least this often
+
+struct ModeTotals {
+  const char* name;
+  uint32_t i2cBytes;
+  uint64_t micros;
+};
+
+extern PowerManager power;
+
+static bool verbose;
+static ModeTotals modeTotals[8];
+static uint8_t modeCount;
+static uint64_t longestLoopUs;
+static uint32_t loopCount;
+static uint32_t slowLoops; // passes over MAX_LOOP_US in the whole run
+
+static void runFor(unsigned long ms) {
+  uint64_t until = simNowMicros() + (uint64_t)ms * 1000;
+  while (simNowMicros() < until) {
+    uint64_t started = simNowMicros();
+    uint64_t sleptBefore = simStats.sleptUs;
+    simAdvance(SIM_COST_LOOP);
+    loop();
+    // the pass ends in sleep, only the work counts
+    uint64_t took = simNowMicros() - started - (simStats.sleptUs - sleptBefore);
+    if (took > longestLoopUs) longestLoopUs = took;
+    if (took > MAX_LOOP_US) slowLoops++;
+    loopCount++;
+  }
+}
+
+static void mode(const char* name) {
+  modeTotals[modeCount].name = name;
+  modeTotals[modeCount].i2cBytes = simStats.i2cBytes;
+  modeTotals[modeCount].micros = simNowMicros();
+  modeCount++;
+  printf("\n%s\n", name);
+}
+
+static void closeModes() {
+  for (uint8_t i = 0; i < modeCount; i++) {
+    uint32_t endBytes = (i + 1 < modeCount) ? modeTotals[i + 1].i2cBytes : simStats.i2cBytes;
+    uint64_t endUs = (i + 1 < modeCount) ? modeTotals[i + 1].micros : simNowMicros();
+    modeTotals[i].i2cBytes = endBytes - modeTotals[i].i2cBytes;
+    modeTotals[i].micros = endUs - modeTotals[i].micros;
+  }
+}
+
+static void printLcdRow(uint8_t row) {
+  char text[17];
+  simLcd.rowShown(row, text);
+  printf("  |%s|\n", text);
+}
+
+static void phase(const char* label, unsigned long ms) {
+  uint32_t bytesBefore = simStats.i2cBytes;
+  uint64_t startedUs = simNowMicros();
+  uint64_t sleptBefore = simStats.sleptUs;
+  longestLoopUs = 0;
+  loopCount = 0;
+  power.awakePercent();
+  runFor(ms);
+  unsigned awakeReported = power.awakePercent();
+  double seconds = (simNowMicros() - startedUs) / 1000000.0;
+  double awake = 100.0 - (simStats.sleptUs - sleptBefore) / (seconds * 10000.0);
+  printf("  %-22s %9.0f loops/s %9.0f I2C B/s %8.2f ms max loop %3u%% awake (%5.1f%% counted)\n", label,
+    loopCount / seconds, (simStats.i2cBytes - bytesBefore) / seconds, longestLoopUs / 1000.0, awakeReported, awake);
+  if (verbose) {
+    printLcdRow(0);
+    printLcdRow(1);
+  }
+}
+
+static void tap(const char* keys) {
+  for (; *keys; keys++) {
+    simSetKey(*keys, true);
+    runFor(KEY_TAP_TIME);
+    simSetKey(*keys, false);
+    runFor(KEY_TAP_TIME);
+  }
+}
+
+// keys are pressed in the given order and released together
+static void hold(const char* keys, unsigned long ms) {
+  for (const char* k = keys; *k; k++) {
+    simSetKey(*k, true);
+    runFor(KEY_TAP_TIME);
+  }
+  runFor(ms);
+  for (const char* k = keys; *k; k++) simSetKey(*k, false);
+  runFor(KEY_TAP_TIME);
+}
+
+static void pressButton(uint8_t pin, const char* label, unsigned long ms, unsigned long extraMs) {
+  simSetButton(pin, true);
+  phase(label, ms);
+  runFor(extraMs);
+  simSetButton(pin, false);
+  runFor(KEY_TAP_TIME);
+}
+
+int main(int argc, char** argv) {
+  const char* bus = NULL;
+  unsigned int speed = 1;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-u") == 0) {
+      bus = argv[i + 1];
+    } else if (strcmp(argv[i], "-x") == 0) {
+      speed = atoi(argv[i + 1]);
+    } else if (strcmp(argv[i], "-s") == 0) {
+      if ((bus != NULL) && !busOpen(bus, speed)) {
+        fprintf(stderr, "can't open %s\n", bus);
+        return 2;
+      }
+      return runScenario(argv[i + 1]);
+    }
+  }
+  verbose = (argc > 1) && (strcmp(argv[1], "-v") == 0);
+
+  simReset();
+  simSetAnalog(CELL_PIN, CELL_HEALTHY);
+  setup();
+  printf("setup() took %.1f ms of simulated time, %u I2C bytes\n",
+    simNowMicros() / 1000.0, (unsigned)simStats.i2cBytes);
+
+  mode("Menu");
+  phase("idle", 5000);
+  tap("bb");
+  phase("after navigation", 1000);
+
+  mode("Timer");
+  tap("bc1b1bc"); // delay 1 min, game 1 min
+  phase("pre-game countdown", 10000);
+  runFor(50000);
+  phase("game countdown", 10000);
+  runFor(52000);
+  phase("ended", 5000);
+  hold("d", 10500);
+
+  mode("Domination");
+  tap("aac0b2bc"); // no delay, game 2 min
+  phase("scoring", 10000);
+  pressButton(T1_BTN, "capturing T1", 5000, 500);
+  phase("T1 holds the point", 10000);
+  runFor(100000);
+  phase("ended", 5000);
+  hold("d", 10500);
+
+  mode("Zone Control");
+  tap("bc");
+  phase("idle", 10000);
+  pressButton(T2_BTN, "capturing T2", 5000, 500);
+  phase("T2 holds the zone", 10000);
+  hold("d*", 10500);
+
+  mode("Defusal");
+  tap("aac0b5bbc"); // no delay, bomb 5 min, no code
+  phase("ready", 10000);
+  pressButton(T1_BTN, "arming", 5000, 300);
+  phase("armed", 10000);
+  pressButton(T2_BTN, "disarming", 10000, 300);
+  phase("disarmed", 5000);
+  hold("d", 10500);
+
+  if (verbose) {
+    printf("\nEvent log, %u EEPROM writes\n", (unsigned)simStats.eepromWrites);
+    simSerialReceive("l\n");
+    runFor(1000);
+  }
+
+  closeModes();
+  printf("\nI2C data bytes per mode\n");
+  for (uint8_t i = 0; i < modeCount; i++) {
+    printf("  %-22s %9u B in %6.1f s\n", modeTotals[i].name,
+      (unsigned)modeTotals[i].i2cBytes, modeTotals[i].micros / 1000000.0);
+  }
+  if (slowLoops > 0) {
+    printf("\nFAILED: %u loop() passes took longer than %u us\n", (unsigned)slowLoops, MAX_LOOP_US);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,302 @@
+/*
+Copyright 2021 Kulverstukas
+
+This file is part of airsoft-bomb.
+
+airsoft-bomb is free software: you can redistribute it and/or modify it
+under the terms of the GNU General Public License as published by the
+Free Software Foundation, either version 3 of the License,
+or (at your option) any later version.
+airsoft-bomb is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+You should have received a copy of the GNU General Public License along with
+airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+*/
+/*
+  Scenario runner: plays a script against the real setup()/loop() on the
+  virtual clock and prints a transcript of what the prop did, to be compared
+  with a golden file by native/run_scenarios.sh.
+
+  A script is statements split by newlines or ';', "//" starts a comment.
+  Durations are a number with ms (the default), s, min or h after it.
+    press KEYS, type KEYS  tap every key in turn, 100ms down and 100ms up
+    hold WHAT DURATION     WHAT is T1, T2 or keys pressed 100ms apart, all let go at the end
+    down WHAT, up WHAT     the same without the timing, for overlapping presses
+    advance DURATION       let the prop run
+    skip DURATION          the same, but only the display at the end goes to the transcript
+    at TIME STATEMENT      run until TIME after the boot screen is up, then do STATEMENT
+    lcd                    print the display even if it didn't change
+    battery READING        ADC reading of the cell, 0-1023
+    serial TEXT            send TEXT and a newline to the prop's UART, 'l' dumps the event log
+  The transcript has every statement, every display change once the bus went
+  quiet, buzzer beeps with their pitch and siren on/off, all with the time.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "Arduino.h"
+#include "SimHal.h"
+#include "sim_scenario.h"
+#include "sim_bus.h"
+#include <PropPins.h>
+#include <LiquidCrystal_I2C.h>
+
+#define CELL_HEALTHY 917 // 3.9V on the prop's divider
+#define KEY_TAP_TIME 100 // ms down and ms up for every key typed
+#define LCD_SETTLE_US 5000 // the display is printed once the bus was quiet for this long
+#define BUZZER_QUIET_US 5000 // no edge for this long and the buzzer is off
+#define MAX_STATEMENT 128
+
+extern LiquidCrystal_I2C lcd;
+
+static uint64_t startUs; // scenario time 0, once setup() ended and what it drew reached the display
+static bool recordLcd;
+static uint32_t lastI2cBytes;
+static uint64_t lastI2cUs;
+static bool lcdDirty;
+static char shownLcd[2][17];
+static bool buzzerOn;
+static uint64_t buzzerOnUs;
+static uint64_t buzzerLastUs; // last edge
+static uint32_t buzzerEdges; // since it went on
+static int lineNumber;
+
+static void stamp(uint64_t us) {
+  uint64_t ms = (us - startUs) / 1000;
+  printf("%4u:%02u.%03u ", (unsigned)(ms / 60000), (unsigned)(ms / 1000 % 60), (unsigned)(ms % 1000));
+}
+
+static void readLcd(char rows[2][17]) {
+  for (uint8_t row = 0; row < 2; row++) simLcd.rowShown(row, rows[row]);
+}
+
+static void printLcd(uint64_t us, bool always) {
+  char rows[2][17];
+  readLcd(rows);
+  if (!always && (memcmp(rows, shownLcd, sizeof(rows)) == 0)) return;
+  memcpy(shownLcd, rows, sizeof(rows));
+  stamp(us);
+  printf("lcd |%s|%s|%s\n", rows[0], rows[1], simLcd.backlight() ? "" : " dark");
+}
+
+// looks at the outputs after every pass of loop()
+static void observe() {
+  uint64_t now = simNowMicros();
+  if (simStats.i2cBytes != lastI2cBytes) {
+    lastI2cBytes = simStats.i2cBytes;
+    lastI2cUs = now;
+    lcdDirty = true;
+  } else if (lcdDirty && ((now - lastI2cUs) >= LCD_SETTLE_US)) {
+    lcdDirty = false;
+    if (recordLcd) printLcd(lastI2cUs, false);
+  }
+
+  if (buzzerOn && ((now - buzzerLastUs) >= BUZZER_QUIET_US)) {
+    buzzerOn = false;
+    // a full period is two edges apart
+    uint64_t took = buzzerLastUs - buzzerOnUs;
+    uint64_t halfPeriods = buzzerEdges - 1;
+    stamp(buzzerLastUs);
+    printf("buzzer off, %u Hz\n", took ? (unsigned)((halfPeriods * 500000 + took / 2) / took) : 0);
+  }
+}
+
+static void pinChanged(uint8_t pin, uint8_t level) {
+  uint64_t now = simNowMicros();
+  if (pin == BUZZER_PIN) {
+    if (!buzzerOn) {
+      buzzerOn = true;
+      buzzerOnUs = now;
+      buzzerEdges = 0;
+      stamp(now);
+      printf("buzzer on\n");
+    }
+    buzzerEdges++;
+    buzzerLastUs = now;
+  } else if (pin == SIREN_PIN) {
+    stamp(now);
+    printf("siren %s\n", level ? "on" : "off");
+  }
+}
+
+static void runUntil(uint64_t until) {
+  while (simNowMicros() < until) {
+    simAdvance(SIM_COST_LOOP);
+    loop();
+    observe();
+    if (busIsOpen()) busPoll();
+  }
+}
+
+static void runFor(unsigned long ms) {
+  runUntil(simNowMicros() + (uint64_t)ms * 1000);
+}
+
+//==============================================
+static void fail(const char* what, const char* token) {
+  fprintf(stderr, "line %d: %s '%s'\n", lineNumber, what, token ? token : "");
+  exit(2);
+}
+
+static bool isUnit(const char* word, size_t length) {
+  static const char* const units[] = { "ms", "s", "min", "h" };
+  for (uint8_t i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+    if ((strlen(units[i]) == length) && (strncmp(word, units[i], length) == 0)) return true;
+  }
+  return false;
+}
+
+// the next word of rest, NULL at the end
+static char* nextWord(char*& rest) {
+  while ((*rest == ' ') || (*rest == '\t')) rest++;
+  if (*rest == '\0') return NULL;
+  char* word = rest;
+  while ((*rest != '\0') && (*rest != ' ') && (*rest != '\t')) rest++;
+  if (*rest != '\0') *rest++ = '\0';
+  return word;
+}
+
+// "5200", "5200 ms", "3s", "10 min", "1.5 s"
+static unsigned long parseDuration(char*& rest) {
+  char* token = nextWord(rest);
+  if (token == NULL) fail("missing duration", NULL);
+  char* unit;
+  double value = strtod(token, &unit);
+  if (unit == token) fail("bad duration", token);
+  if (*unit == '\0') {
+    // the unit may come as the next word
+    char* next = rest;
+    while ((*next == ' ') || (*next == '\t')) next++;
+    if (isUnit(next, strcspn(next, " \t"))) unit = nextWord(rest);
+    else unit = (char*)"ms";
+  }
+  if (strcmp(unit, "ms") == 0) return (unsigned long)value;
+  if (strcmp(unit, "s") == 0) return (unsigned long)(value * 1000);
+  if (strcmp(unit, "min") == 0) return (unsigned long)(value * 60000);
+  if (strcmp(unit, "h") == 0) return (unsigned long)(value * 3600000);
+  fail("unknown unit", unit);
+  return 0;
+}
+
+// a team button by name, or the keys of the word pressed one after another
+static void setTarget(const char* target, bool down) {
+  if (strcmp(target, "T1") == 0) {
+    simSetButton(T1_BTN_PIN, down);
+  } else if (strcmp(target, "T2") == 0) {
+    simSetButton(T2_BTN_PIN, down);
+  } else {
+    for (const char* k = target; *k; k++) {
+      if (!simSetKey(*k, down)) fail("no such key", target);
+      if (down && k[1]) runFor(KEY_TAP_TIME);
+    }
+  }
+}
+
+static void execute(char* statement);
+
+static void command(char* word, char*& rest) {
+  if ((strcmp(word, "press") == 0) || (strcmp(word, "type") == 0)) {
+    char* keys = nextWord(rest);
+    if (keys == NULL) fail("missing keys", word);
+    for (char* k = keys; *k; k++) {
+      if (!simSetKey(*k, true)) fail("no such key", keys);
+      runFor(KEY_TAP_TIME);
+      simSetKey(*k, false);
+      runFor(KEY_TAP_TIME);
+    }
+  } else if (strcmp(word, "hold") == 0) {
+    char* target = nextWord(rest);
+    if (target == NULL) fail("missing key or button", word);
+    unsigned long ms = parseDuration(rest);
+    setTarget(target, true);
+    runFor(ms);
+    setTarget(target, false);
+  } else if ((strcmp(word, "down") == 0) || (strcmp(word, "up") == 0)) {
+    char* target = nextWord(rest);
+    if (target == NULL) fail("missing key or button", word);
+    setTarget(target, word[0] == 'd');
+  } else if (strcmp(word, "advance") == 0) {
+    runFor(parseDuration(rest));
+  } else if (strcmp(word, "skip") == 0) {
+    // no display changes on the way, only where it ends up
+    recordLcd = false;
+    runFor(parseDuration(rest));
+    recordLcd = true;
+    printLcd(simNowMicros(), false);
+  } else if (strcmp(word, "at") == 0) {
+    uint64_t at = startUs + (uint64_t)parseDuration(rest) * 1000;
+    if (at < simNowMicros()) fail("already past", word);
+    runUntil(at);
+    execute(rest);
+    rest += strlen(rest);
+  } else if (strcmp(word, "lcd") == 0) {
+    printLcd(simNowMicros(), true);
+  } else if (strcmp(word, "battery") == 0) {
+    char* value = nextWord(rest);
+    if (value == NULL) fail("missing ADC reading", word);
+    simSetAnalog(CELL_PIN, atoi(value));
+  } else if (strcmp(word, "serial") == 0) {
+    char* text = nextWord(rest);
+    if (text == NULL) fail("missing text", word);
+    simSerialReceive(text);
+    simSerialReceive("\n");
+  } else {
+    fail("unknown command", word);
+  }
+}
+
+static void execute(char* statement) {
+  char* rest = statement;
+  char* word = nextWord(rest);
+  if (word == NULL) return;
+  command(word, rest);
+  char* extra = nextWord(rest);
+  if (extra != NULL) fail("unexpected", extra);
+}
+
+//==============================================
+int runScenario(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "can't open %s\n", path);
+    return 2;
+  }
+
+  simReset();
+  simSetAnalog(CELL_PIN, CELL_HEALTHY);
+  setup();
+  // setup() only queues its last screen, the first snapshot is of the display and not of a half sent queue
+  lcd.flush();
+  startUs = simNowMicros();
+  recordLcd = true;
+  lastI2cBytes = simStats.i2cBytes;
+  simWatchPins(pinChanged);
+  printLcd(startUs, true);
+
+  char line[MAX_STATEMENT];
+  while (fgets(line, sizeof(line), file) != NULL) {
+    lineNumber++;
+    char* comment = strstr(line, "//");
+    if (comment != NULL) *comment = '\0';
+    line[strcspn(line, "\r\n")] = '\0';
+    char* rest;
+    for (char* statement = strtok_r(line, ";", &rest); statement; statement = strtok_r(NULL, ";", &rest)) {
+      while (isspace((unsigned char)*statement)) statement++;
+      if (*statement == '\0') continue;
+      for (char* end = statement + strlen(statement); isspace((unsigned char)end[-1]); end--) end[-1] = '\0';
+      stamp(simNowMicros());
+      printf("> %s\n", statement);
+      // execute() takes the statement apart
+      char copy[MAX_STATEMENT];
+      strcpy(copy, statement);
+      execute(copy);
+    }
+  }
+  fclose(file);
+  // let the last changes settle into the transcript
+  runFor(LCD_SETTLE_US / 1000 + 1);
+  return 0;
+}
@@ -0,0 +1,158 @@
+# Copyright 2021 Kulverstukas
+#
+# This file is part of airsoft-bomb.
+#
+# airsoft-bomb is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+# airsoft-bomb is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+# You should have received a copy of the GNU General Public License along with
+# airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+#
+# Frames the props send on their UART (see lib/PropSync), taken apart for the
+# tools on the host. Anything between frames is text, lines the props print.
+
+FRAME_START = 0x7E
+# type: name, payload length
+FRAME_TYPES = {0: ("clock", 4), 1: ("start", 9), 2: ("stop", 0), 3: ("owner", 1), 4: ("telemetry", 14)}
+NOT_ON_BUS = 0x0F  # sender of a prop that has no id
+NO_TEAM = 0xFF
+GAME_NONE = 0xFF
+MODES = ["timer", "domination", "zone control", "defusal"]
+# the states of each mode in src/main.cpp, in their order
+PHASES = [
+    ["delay", "game"],
+    ["delay", "scoring", "capturing"],
+    ["scoring", "capturing"],
+    ["delay", "ready", "arming", "armed", "disarming", "disarmed", "exploded"],
+]
+# Telemetry::flags
+RUNNING = 0x01
+SIREN = 0x02
+T1_HELD = 0x04
+T2_HELD = 0x08
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def mode_name(mode):
+    if mode == GAME_NONE:
+        return "menu"
+    return MODES[mode] if mode < len(MODES) else str(mode)
+
+
+def phase_name(mode, phase):
+    if mode < len(PHASES) and phase < len(PHASES[mode]):
+        return PHASES[mode][phase]
+    return "-" if mode == GAME_NONE else str(phase)
+
+
+def team_name(team):
+    return "-" if team == NO_TEAM else "T%d" % (team + 1)
+
+
+def sender_name(sender):
+    return "-" if sender == NOT_ON_BUS else str(sender)
+
+
+def telemetry(payload):
+    """The fields of a telemetry payload, by their names in Telemetry."""
+    return {
+        "sequence": payload[0],
+        "mode": payload[1],
+        "phase": payload[2],
+        "flags": payload[3],
+        "remaining": int.from_bytes(payload[4:8], "little"),
+        "score": (int.from_bytes(payload[8:10], "little"), int.from_bytes(payload[10:12], "little")),
+        "owner": payload[12],
+        "progress": payload[13],
+    }
+
+
+def describe_telemetry(t):
+    mode = t["mode"]
+    text = mode_name(mode)
+    if mode != GAME_NONE:
+        text += " " + phase_name(mode, t["phase"])
+        if not t["flags"] & RUNNING:
+            text += " (ended)"
+        if t["remaining"]:
+            seconds = t["remaining"] // 1000
+            text += ", %d:%02d left" % (seconds // 60, seconds % 60)
+        if mode in (1, 2):
+            text += ", score %d:%d, point %s" % (t["score"][0], t["score"][1], team_name(t["owner"]))
+        if t["progress"]:
+            text += ", hold %d%%" % (t["progress"] * 100 // 255)
+    held = [name for bit, name in ((T1_HELD, "T1"), (T2_HELD, "T2")) if t["flags"] & bit]
+    if held:
+        text += ", " + "+".join(held) + " held"
+    if t["flags"] & SIREN:
+        text += ", siren"
+    return text
+
+
+def describe(frame):
+    kind, sender, payload = frame[0] >> 4, sender_name(frame[0] & 0x0F), frame[1:-1]
+    name = FRAME_TYPES[kind][0]
+    if kind == 0:
+        return "%s from %s: %d ms" % (name, sender, int.from_bytes(payload, "little"))
+    if kind == 1:
+        return "%s from %s: %s, delay %d min, game %d min, at %d ms" % (
+            name, sender, mode_name(payload[0]), int.from_bytes(payload[1:3], "little"),
+            int.from_bytes(payload[3:5], "little"), int.from_bytes(payload[5:9], "little"))
+    if kind == 3:
+        return "%s from %s: %s" % (name, sender, team_name(payload[0]))
+    if kind == 4:
+        return "%s from %s #%d: %s" % (name, sender, payload[0], describe_telemetry(telemetry(payload)))
+    return "%s from %s" % (name, sender)
+
+
+class FrameReader:
+    """Splits a byte stream into frames and lines of text.
+
+    on_frame gets each frame with a good CRC, type byte to CRC, on_text each
+    line and on_bad is called for a frame with a bad CRC.
+    """
+
+    def __init__(self, on_frame, on_text, on_bad):
+        self.on_frame = on_frame
+        self.on_text = on_text
+        self.on_bad = on_bad
+        self.frame = None
+        self.expected = 0
+        self.text = bytearray()
+
+    def feed(self, data):
+        for byte in data:
+            if self.frame is not None:
+                self.frame.append(byte)
+                if len(self.frame) == 1:
+                    kind = byte >> 4
+                    if kind not in FRAME_TYPES:
+                        self.frame = None
+                        continue
+                    self.expected = 1 + FRAME_TYPES[kind][1] + 1
+                if len(self.frame) == self.expected:
+                    if crc8(self.frame[:-1]) == self.frame[-1]:
+                        self.on_frame(bytes(self.frame))
+                    else:
+                        self.on_bad()
+                    self.frame = None
+            elif byte == FRAME_START:
+                self.frame = bytearray()
+            elif byte in (0x0A, 0x0D):
+                if self.text:
+                    self.on_text(self.text.decode(errors="replace"))
+                self.text = bytearray()
+            else:
+                self.text.append(byte)
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+# Copyright 2021 Kulverstukas
+#
+# This file is part of airsoft-bomb.
+#
+# airsoft-bomb is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+# airsoft-bomb is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+# You should have received a copy of the GNU General Public License along with
+# airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+#
+# Live view of the props for a referee: a laptop on the bus (or on the USB
+# port of a single prop) shows the telemetry the props send, a line per prop.
+# Turn it on at the props with "t" and a period in ms, e.g. "t500".
+#
+# Usage: native/referee.py [-b BAUD] [-l] PORT
+# PORT is the serial device, or - to read standard input, like the output
+# of the simulated prop. -l prints every snapshot on its own line instead.
+
+import argparse
+import os
+import select
+import sys
+import termios
+import time
+import tty
+
+from prop_frames import FrameReader, NOT_ON_BUS, describe_telemetry, sender_name, telemetry
+
+STALE = 3  # s without a snapshot before a prop is marked silent
+
+
+def open_port(path, baud):
+    if path == "-":
+        return sys.stdin.buffer.fileno()
+    fd = os.open(path, os.O_RDONLY | os.O_NOCTTY)
+    tty.setraw(fd)
+    attributes = termios.tcgetattr(fd)
+    speed = getattr(termios, "B%d" % baud)
+    attributes[4] = attributes[5] = speed
+    termios.tcsetattr(fd, termios.TCSANOW, attributes)
+    return fd
+
+
+class Props:
+    """The last snapshot of every prop, and how many went missing."""
+
+    def __init__(self):
+        self.last = {}  # sender: (time, snapshot)
+        self.missed = {}
+
+    def add(self, sender, snapshot):
+        if sender in self.last:
+            gap = (snapshot["sequence"] - self.last[sender][1]["sequence"] - 1) & 0xFF
+            self.missed[sender] = self.missed.get(sender, 0) + gap
+        else:
+            self.missed[sender] = 0
+        self.last[sender] = (time.monotonic(), snapshot)
+
+    def draw(self):
+        now = time.monotonic()
+        lines = ["\033[H\033[J", "prop  missed  state\n"]
+        # the one off the bus last, it is alone on the port
+        for sender in sorted(self.last, key=lambda s: (s == NOT_ON_BUS, s)):
+            at, snapshot = self.last[sender]
+            state = "SILENT" if now - at > STALE else describe_telemetry(snapshot)
+            lines.append("%-4s  %6d  %s\n" % (sender_name(sender), self.missed[sender], state))
+        sys.stdout.write("".join(lines))
+        sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Show the telemetry of the props.")
+    parser.add_argument("-b", "--baud", type=int, default=115200)
+    parser.add_argument("-l", "--log", action="store_true", help="a line per snapshot")
+    parser.add_argument("port")
+    args = parser.parse_args()
+
+    fd = open_port(args.port, args.baud)
+    props = Props()
+
+    def on_frame(frame):
+        if frame[0] >> 4 != 4:
+            return
+        sender = frame[0] & 0x0F
+        snapshot = telemetry(frame[1:-1])
+        props.add(sender, snapshot)
+        if args.log:
+            print("%s prop %s #%d: %s" % (time.strftime("%H:%M:%S"), sender_name(sender), snapshot["sequence"],
+                                          describe_telemetry(snapshot)), flush=True)
+
+    reader = FrameReader(on_frame, lambda text: None, lambda: None)
+    while True:
+        ready, _, _ = select.select([fd], [], [], 0.5)
+        if ready:
+            data = os.read(fd, 4096)
+            if not data:
+                return 0
+            reader.feed(data)
+        if not args.log:
+            props.draw()
+
+
+if __name__ == "__main__":
+    try:
+        sys.exit(main())
+    except KeyboardInterrupt:
+        sys.exit(0)
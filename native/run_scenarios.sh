@@ -0,0 +1,30 @@
+#!/bin/sh
+# Plays every scenario in native/scenarios on the host build and compares
+# the transcript with its golden file. --update writes the goldens instead.
+# Usage: native/run_scenarios.sh [--update] [program]
+# program defaults to what "pio run -e native" builds.
+
+update=no
+if [ "$1" = "--update" ]; then
+  update=yes
+  shift
+fi
+program=${1:-.pio/build/native/program}
+dir=$(dirname "$0")/scenarios
+failed=0
+
+for script in "$dir"/*.scn; do
+  name=$(basename "$script" .scn)
+  golden="$dir/$name.golden"
+  if [ "$update" = yes ]; then
+    "$program" -s "$script" > "$golden" || failed=1
+    echo "updated $name"
+  elif "$program" -s "$script" | diff -u "$golden" - > /dev/null; then
+    echo "ok      $name"
+  else
+    echo "FAILED  $name"
+    "$program" -s "$script" | diff -u "$golden" - | head -40
+    failed=1
+  fi
+done
+exit $failed
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+# Copyright 2021 Kulverstukas
+#
+# This file is part of airsoft-bomb.
+#
+# airsoft-bomb is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+# airsoft-bomb is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+# You should have received a copy of the GNU General Public License along with
+# airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+#
+# Puts simulated props on one bus, like RS-485: each prop runs as its own
+# process with its UART on a pseudo-terminal, and what one of them sends all
+# the others receive. Their transcripts are printed as they come, marked with
+# the number of the prop, and so is the bus traffic, frames decoded.
+#
+# Usage: native/sim_bus.py [-x SPEED] [-p PROGRAM] SCRIPT...
+# The first script is prop [0], and so on; which of them is the master is
+# up to the scripts ("serial s0"). SPEED runs the virtual clocks that many
+# times faster than the wall clock.
+
+import argparse
+import os
+import pty
+import select
+import subprocess
+import sys
+import tty
+
+from prop_frames import FrameReader, describe
+
+
+class BusReader:
+    """Shows what one prop sends, frames decoded."""
+
+    def __init__(self, prop, show):
+        self.reader = FrameReader(
+            lambda frame: show(prop, "bus " + describe(frame)),
+            lambda text: show(prop, "bus text: " + text),
+            lambda: show(prop, "bus frame with a bad CRC"))
+
+    def feed(self, data):
+        self.reader.feed(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run simulated props on one bus.")
+    parser.add_argument("-x", "--speed", type=int, default=1, help="virtual time per wall time")
+    parser.add_argument("-p", "--program", default=".pio/build/native/program")
+    parser.add_argument("-q", "--quiet", action="store_true", help="don't print the clock, owner and telemetry frames")
+    parser.add_argument("scripts", nargs="+")
+    args = parser.parse_args()
+
+    def show(prop, line):
+        if args.quiet and (" clock from " in line or " owner from " in line or " telemetry from " in line):
+            return
+        sys.stdout.write("[%d] %s\n" % (prop, line))
+        sys.stdout.flush()
+
+    terminals = []  # our ends, a prop each
+    keep = []  # their ends stay open here too, so ours don't hang up between the prop's opens
+    readers = {}
+    outputs = {}
+    partial = {}
+    props = []
+    for prop, script in enumerate(args.scripts):
+        ours, theirs = pty.openpty()
+        tty.setraw(ours)
+        tty.setraw(theirs)
+        terminals.append(ours)
+        keep.append(theirs)
+        readers[ours] = BusReader(prop, show)
+        command = [args.program, "-u", os.ttyname(theirs), "-x", str(args.speed), "-s", script]
+        process = subprocess.Popen(command, stdout=subprocess.PIPE)
+        props.append(process)
+        outputs[process.stdout.fileno()] = prop
+        partial[process.stdout.fileno()] = b""
+
+    while outputs:
+        ready, _, _ = select.select(terminals + list(outputs), [], [])
+        for fd in ready:
+            data = os.read(fd, 4096)
+            if fd in readers:
+                readers[fd].feed(data)
+                for other in terminals:
+                    if other != fd:
+                        os.write(other, data)
+            elif not data:
+                if partial[fd]:
+                    show(outputs[fd], partial[fd].decode(errors="replace"))
+                del outputs[fd]
+            else:
+                lines = (partial[fd] + data).split(b"\n")
+                partial[fd] = lines.pop()
+                for line in lines:
+                    show(outputs[fd], line.decode(errors="replace"))
+
+    return max(process.wait() for process in props)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
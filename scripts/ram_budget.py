@@ -0,0 +1,52 @@
+# Copyright 2021 Kulverstukas
+#
+# This file is part of airsoft-bomb.
+#
+# airsoft-bomb is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the
+# Free Software Foundation, either version 3 of the License,
+# or (at your option) any later version.
+# airsoft-bomb is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+# or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+# You should have received a copy of the GNU General Public License along with
+# airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
+#
+# PlatformIO post action: fails the build when .data + .bss leave less than
+# custom_ram_min_free bytes of SRAM for the stack and the heap.
+# The stack is not measured, so keep the margin above the deepest call chain
+# plus the interrupt frames nested on top of it.
+
+Import("env")
+
+import subprocess
+
+SECTIONS = (".data", ".bss", ".noinit")
+
+
+def section_sizes(elf):
+    out = subprocess.check_output([env.subst("$SIZETOOL"), "-A", elf]).decode()
+    sizes = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0] in SECTIONS:
+            sizes[parts[0]] = int(parts[1])
+    return sizes
+
+
+def check_ram_budget(source, target, env):
+    elf = str(target[0])
+    sizes = section_sizes(elf)
+    ram = int(env.BoardConfig().get("upload.maximum_ram_size", 2048))
+    min_free = int(env.GetProjectOption("custom_ram_min_free", "512"))
+    used = sum(sizes.get(name, 0) for name in SECTIONS)
+    free = ram - used
+    print("RAM budget: .data %d + .bss %d + .noinit %d = %d of %d bytes, %d left for stack and heap (minimum %d)" % (
+        sizes.get(".data", 0), sizes.get(".bss", 0), sizes.get(".noinit", 0), used, ram, free, min_free))
+    if free < min_free:
+        print("RAM budget exceeded by %d bytes" % (min_free - free))
+        return 1
+    return 0
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", check_ram_budget)
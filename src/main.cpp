@@ -16,20 +16,58 @@ airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
 
 #include <Arduino.h>
 #include <WString.h>
-#include <Keypad.h>
-#include <Wire.h>
+#include <MatrixKeypad.h>
 #include <LiquidCrystal_I2C.h>
+#include <LcdFrameBuffer.h>
 #include <LcdBarGraphI2C.h>
-#include <menu.cpp>
+#include <LcdBigDigits.h>
+#include <Decimal.h>
+#include <TaskQueue.h>
+#include <SoundSequencer.h>
+#include <BatteryMonitor.h>
+#include <TeamButtons.h>
+#include <PowerManager.h>
+#include <GameEngine.h>
+#include <EventLog.h>
+#include <PresetStore.h>
+#include <Timebase.h>
+#include <PropSync.h>
+#include <LoopProfiler.h>
+#include <PropPins.h>
 
 /* set this to false to skip compiling battery checking functionality */
-#define CHECK_BATTERY false
+#define CHECK_BATTERY true
+/* set this to false to count the timer and a bomb armed with buttons down in one row */
+#define BIG_COUNTDOWN true
+/*
+  The game modes in the firmware. A mode set to false leaves its code, its menu line and its
+  texts out of the image, for props that only ever play one thing. The PlatformIO envs of such
+  props set them with -D, see platformio.ini
+*/
+#ifndef MODE_TIMER
+  #define MODE_TIMER true
+#endif
+#ifndef MODE_DOMINATION
+  #define MODE_DOMINATION true
+#endif
+#ifndef MODE_ZONE_CONTROL
+  #define MODE_ZONE_CONTROL true
+#endif
+#ifndef MODE_DEFUSAL
+  #define MODE_DEFUSAL true
+#endif
+#define POINT_MODES (MODE_DOMINATION || MODE_ZONE_CONTROL) // a point the teams capture with their buttons
+#define COUNTDOWN_MODES (MODE_TIMER || MODE_DOMINATION || MODE_DEFUSAL) // a time left on screen
+#if !(MODE_TIMER || MODE_DEFUSAL)
+  #undef BIG_COUNTDOWN
+  #define BIG_COUNTDOWN false // nothing else counts down in big digits
+#endif
+static_assert(MODE_TIMER || POINT_MODES || MODE_DEFUSAL, "build at least one game mode");
+
+// the menu lists the modes that are built
+#include <menu.cpp>
 
 #define PROJECT_VERSION "1.3"
-#define BUZZER_PIN 5
-#define T1_BTN_PIN 6
-#define T2_BTN_PIN 7
-#define SIREN_PIN 8
 #define KEYPAD_ROWS 4
 #define KEYPAD_COLS 4
 #define LCD_COLS 16
@@ -42,134 +80,315 @@ airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
 #define SIREN_DURATION_START_GAME 8000
 #define SIREN_DURATION_END_GAME 12000
 #define SIREN_DELAY_TIME 5000
+#define INVALID_INPUT_TIME 3000
+#define BACKLIGHT_TIMEOUT 60000 // nobody touched the prop for this long, 0 keeps the backlight on
+#define BAD_CODE_TIME 1000 // how long BAD CODE stays on screen when the bomb is armed
+#define BAD_ARM_CODE_TIME 1500 // and when it isn't
+#define PRESET_START 0 // EEPROM address of the game presets
+#define SETTINGS_START 64 // EEPROM address of the clock calibration and the bus id
+#define EVENT_LOG_START 72 // the EEPROM below is left for settings
+#define EVENT_LOG_SIZE 952 // up to the end of the 1KB
+#define EVENT_LOG_LINE_MAX 40 // the log is printed a line at a time once this fits into the serial buffer
 #if CHECK_BATTERY
-  #define CELL_PIN 17
-  #define CELL_LED 2
-  #define MAX_VOLTAGE 4.35 // such value is needed to correctly calculate the actual voltage
+  #define MAX_VOLTAGE_MV 4350 // such value is needed to correctly calculate the actual voltage
+  #define LOW_VOLTAGE_MV 3400
+  #define RECOVER_VOLTAGE_MV 3500 // the LED goes off again only above this, so it doesn't flicker around the limit
+  #define BATTERY_CHECK_INTERVAL 1000
 #endif
 
-char keys[KEYPAD_ROWS][KEYPAD_COLS] = {
+const char keys[KEYPAD_ROWS][KEYPAD_COLS] PROGMEM = {
   {'1','2','3', 'a'},
   {'4','5','6', 'b'},
   {'7','8','9', 'c'},
   {'*','0','#', 'd'}
 };
-byte rowPins[KEYPAD_ROWS] = {12, 11, 10, 9};
-byte colPins[KEYPAD_COLS] = {16, 15, 14, 13};
-Keypad kpd = Keypad(makeKeymap(keys), rowPins, colPins, KEYPAD_ROWS, KEYPAD_COLS);
-bool timerStarted;
-bool dominationStarted;
-bool zoneControlStarted;
-bool defusalStarted;
-bool printedLine; // used to prevent refresh of the first line when counting pre-game time
-bool showScore; // used to indicate that pre-game time has finished and domination score can now be shown
-bool isDisarmed;
-bool isDisarming; // used to prevent screen update and switch to progress bar printing in multiple modes
-bool isArmed;
-bool isArming;
-bool isInScoreScreen;
-bool useDefusalCode; // should the mode be played with code or not
-bool ignoreBtn; // used in defusal mode to check if arming button was released after the bomb was planted
+MatrixKeypad kpd(makeKeymap(keys)); // rows and columns are in PropPins.h
+// the game modes, in the order of gameModes[] further down
+enum GameModeId { GAME_TIMER, GAME_DOMINATION, GAME_ZONE_CONTROL, GAME_DEFUSAL, GAME_MODES };
+// a bit per mode that is built. The ids stay the same in every build, they go on the bus and into EEPROM
+constexpr byte builtModes = (MODE_TIMER << GAME_TIMER) | (MODE_DOMINATION << GAME_DOMINATION) |
+  (MODE_ZONE_CONTROL << GAME_ZONE_CONTROL) | (MODE_DEFUSAL << GAME_DEFUSAL);
+extern const GameMode gameModes[GAME_MODES];
+GameEngine games(gameModes, GAME_MODES);
+// every mode keeps its own state
+enum TimerState : byte { TIMER_DELAY, TIMER_GAME };
+enum DominationState : byte { DOMINATION_DELAY, DOMINATION_SCORING, DOMINATION_CAPTURING };
+enum ZoneControlState : byte { ZONE_SCORING, ZONE_CAPTURING };
+enum DefusalState : byte {
+  DEFUSAL_DELAY,
+  DEFUSAL_READY,
+  DEFUSAL_ARMING,
+  DEFUSAL_ARMED,
+  DEFUSAL_DISARMING,
+  DEFUSAL_DISARMED,
+  DEFUSAL_EXPLODED
+};
+// what a team hold on the point did on this pass of loop()
+enum CaptureResult { CAPTURE_IDLE, CAPTURE_HOLDING, CAPTURE_TAKEN };
+#define NO_TEAM 0xFF
+
+struct TimerGame {
+  TimerState state;
+  unsigned long phaseMillis[2]; // the running phase first: delay and game time, then game time
+};
+// domination and zone control score a point the same way
+struct PointScore {
+  unsigned int score[2];
+  byte owner; // team holding the point, NO_TEAM before the first capture
+};
+struct DominationGame {
+  PointScore point;
+  DominationState state;
+  unsigned long phaseMillis[2]; // like in the timer
+};
+struct ZoneControlGame {
+  PointScore point;
+  ZoneControlState state;
+};
+struct DefusalGame {
+  DefusalState state;
+  bool useCode : 1; // should the mode be played with code or not
+  bool ignoreButtons : 1; // the button that armed the bomb wasn't let go yet
+  byte badCodes;
+  unsigned long delayMillis;
+  unsigned long bombMillis;
+  unsigned long elapsedMillis; // of the bomb time
+  unsigned long lastBeepMillis; // to know when last time beep happened
+  char code[MAX_CODE_LEN+1]; // as typed so far
+};
+// what was typed in for a mode the last time it was started
+struct GamePreset {
+  char delay[MAX_USER_INPUT_LEN+1];
+  char time[MAX_USER_INPUT_LEN+1]; // game minutes, bomb minutes in defusal
+  char code[MAX_CODE_LEN+1];
+};
+static_assert(sizeof(GamePreset) <= PRESET_MAX_SIZE, "a preset doesn't fit into its slot");
+// what isn't a game's, set over serial
+struct Settings {
+  int16_t drift; // ppm, see Timebase::setDrift()
+  byte syncId; // of the prop on the bus, PROP_SYNC_OFF when it runs on its own
+  uint16_t telemetryPeriod; // ms, 0 for none
+};
+static_assert(PRESET_START + (sizeof(GamePreset) + 1) * GAME_MODES <= SETTINGS_START, "presets run into the settings");
+static_assert(SETTINGS_START + sizeof(Settings) + 1 <= EVENT_LOG_START, "settings run into the event log");
+static_assert(NO_TEAM == PROP_SYNC_NO_OWNER, "point owners go on the bus as they are");
+// only one mode runs at a time, so they all share the same bytes. enter sets up every field
+union {
+  #if MODE_TIMER
+    TimerGame timer;
+  #endif
+  #if MODE_DOMINATION
+    DominationGame domination;
+  #endif
+  #if MODE_ZONE_CONTROL
+    ZoneControlGame zoneControl;
+  #endif
+  #if MODE_DEFUSAL
+    DefusalGame defusal;
+  #endif
+} game;
+
+struct {
+  bool printedLine : 1; // used to prevent refresh of the first line when counting pre-game time
+  bool showingMessage : 1; // a timed message is on screen: keys are ignored and the screen under it isn't redrawn
+  bool dumpingLog : 1; // the event log is going out over Serial
+  byte heldButtons : TEAM_BUTTONS; // a bit per team button, as of the last button event handled
+} flags;
 #if CHECK_BATTERY
-  bool lowBattery;
+  BatteryMonitor battery(CELL_PIN, MAX_VOLTAGE_MV, LOW_VOLTAGE_MV, RECOVER_VOLTAGE_MV);
 #endif
-bool teamScoreSwitcher[2];
-byte badCodeCounter;
 unsigned long startedMillis;
-unsigned long currMillisLoop; // this is only used in loop()
-unsigned long currMillisDefusal; // only for defusal mode
+unsigned long currMillisLoop; // when the hold on screen started, TIME_UNSET if there is none
+unsigned long holdFloorMillis; // holds count from their press, but never from before this
+unsigned long btnPressedMillis[TEAM_BUTTONS];
+unsigned long anyBtnPressedMillis; // when the first of the held buttons went down
 unsigned long lastMillis; // for timekeeping, to know when to execute a block of code
-unsigned long lastBeepMillis; // to know when last time beep happened
-unsigned long sirenStartedMillis;
-unsigned long timerMillis[2]; // holds delay and game times
-unsigned long defusalMillis[2]; // holds delay and game times
-unsigned int dominationScore[2];
-char defusalCode[MAX_CODE_LEN+1];
-int mainMenuLineIdx;
+byte mainMenuLineIdx;
+byte userCodeInputCount; // characters of the code typed in during defusal
+const __FlashStringHelper* invalidInputText; // which input was wrong, for showInvalidInput()
+byte invalidInputLine;
+
+// everything that used to wait in delay() is queued here and picked up by loop()
+TaskQueue tasks;
+
+// presses and releases come with the time they happened at
+TeamButtons buttons;
+
+// buzzer and siren patterns, played from a timer interrupt
+SoundSequencer sound;
+const SoundStep keypressSound[] PROGMEM = { {1000, 100}, SOUND_END };
+const SoundStep enterKeySound[] PROGMEM = { {1400, 100}, SOUND_END };
+const SoundStep backKeySound[] PROGMEM = { {400, 100}, SOUND_END };
+const SoundStep bombBeepSound[] PROGMEM = { {BEEP_TONE, 125}, SOUND_END }; // 125 millis is the same as in CSGO, apparently
+const SoundStep chirpSound[] PROGMEM = { {700, 2000}, SOUND_END }; // bomb armed or point taken
+const SoundStep startGameSiren[] PROGMEM = { {SIREN_ON, SIREN_DURATION_START_GAME}, SOUND_END };
+const SoundStep endGameSiren[] PROGMEM = { {SIREN_ON, SIREN_DURATION_END_GAME}, SOUND_END };
+// the game is already over when this starts, give players a moment before the siren
+const SoundStep delayedEndGameSiren[] PROGMEM = { {0, SIREN_DELAY_TIME}, {SIREN_ON, SIREN_DURATION_END_GAME}, SOUND_END };
 
 // LCD initialization
 LiquidCrystal_I2C lcd(0x27, LCD_COLS, LCD_ROWS);
-LcdBarGraphI2C lbg(&lcd, LCD_COLS, 0, 1);
+// all game screens are drawn here and sent to the LCD once per loop(), only the changed cells
+LcdFrameBuffer lcdFb(&lcd);
+#if POINT_MODES || MODE_DEFUSAL
+  LcdBarGraphI2C lbg(&lcdFb, LCD_COLS, 0, 1);
+#endif
+#if BIG_COUNTDOWN
+  LcdBigDigits bigDigits(&lcdFb);
+#endif
+#if COUNTDOWN_MODES
+  // the one-row time, counted down in BCD so only the digits that changed are drawn
+  BcdCountdown timeShown;
+  struct {
+    byte col;
+    byte row;
+    byte blanked; // of the frame buffer when it was drawn
+    bool wide; // three digits of minutes
+    bool drawn;
+  } timeCells;
+#endif
+// sleeps between interrupts, any key or team button lights the display up again
+PowerManager power(&lcd, BACKLIGHT_TIMEOUT);
+
+// a slot per mode, zone control's stays empty
+PresetStore presets(PRESET_START, sizeof(GamePreset), GAME_MODES);
+PresetStore settingsStore(SETTINGS_START, sizeof(Settings), 1);
+// the other props of the field on the UART, if there are any
+void syncedStart(const SyncStart& start);
+void syncedStop();
+void fillTelemetry(Telemetry& snapshot);
+PropSync sync(Serial, syncedStart, syncedStop, fillTelemetry);
+// what happened in the games, kept in EEPROM. Sending 'l' over serial prints it
+EventLog eventLog(EVENT_LOG_START, EVENT_LOG_SIZE);
 
-// menu initialization. It's built in menu.cpp file
-LiquidMenu mainMenu(lcd);
+// the menu draws through the frame buffer too, its screens are tables in menu.cpp
+LcdMenu mainMenu(&lcdFb);
+
+#if LOOP_PROFILER
+// what the profiler times, holding 'a' and pressing 'b' prints it over Serial
+enum ProfileSection : byte {
+  PROFILE_LOOP,
+  PROFILE_KEYPAD,
+  PROFILE_MENU,
+  PROFILE_BAR_GRAPH,
+  PROFILE_PRINT_TIME,
+  PROFILE_TIMER,
+  PROFILE_DOMINATION,
+  PROFILE_ZONE_CONTROL,
+  PROFILE_DEFUSAL,
+  PROFILE_LCD,
+  PROFILE_SECTIONS
+};
+static_assert(PROFILE_SECTIONS <= LOOP_PROFILER_SECTIONS, "raise LOOP_PROFILER_SECTIONS");
+const char profileLoopName[] PROGMEM = "loop";
+const char profileKeypadName[] PROGMEM = "getKey";
+const char profileMenuName[] PROGMEM = "menu update";
+const char profileBarGraphName[] PROGMEM = "drawValue";
+const char profilePrintTimeName[] PROGMEM = "printTime";
+const char profileTimerName[] PROGMEM = "timer";
+const char profileDominationName[] PROGMEM = "domination";
+const char profileZoneControlName[] PROGMEM = "zone control";
+const char profileDefusalName[] PROGMEM = "defusal";
+const char profileLcdName[] PROGMEM = "lcd update";
+const char* const profileNames[PROFILE_SECTIONS] PROGMEM = {
+  profileLoopName,
+  profileKeypadName,
+  profileMenuName,
+  profileBarGraphName,
+  profilePrintTimeName,
+  profileTimerName,
+  profileDominationName,
+  profileZoneControlName,
+  profileDefusalName,
+  profileLcdName
+};
+#endif
 
 void playKeypress(char key) {
-    noTone(BUZZER_PIN);
     switch (key) {
       case 'c':
-        tone(BUZZER_PIN, 1400, 100);
+        sound.play(enterKeySound);
         break;
       case 'd':
-        tone(BUZZER_PIN, 400, 100);
+        sound.play(backKeySound);
         break;
       default:
-        tone(BUZZER_PIN, 1000, 100);
+        sound.play(keypressSound);
     }
 }
 
-void useSiren(bool start) {
-  if (start) {
-    sirenStartedMillis = millis();
-    digitalWrite(SIREN_PIN, HIGH);
-  } else {
-    sirenStartedMillis = 0;
-    digitalWrite(SIREN_PIN, LOW);
-  }
+void printToLcd(bool clear, byte col, byte row, const __FlashStringHelper* text) {
+  if (clear) lcdFb.clear();
+  lcdFb.setCursor(col, row);
+  lcdFb.print(text);
 }
 
-void printToLcd(bool clear, byte col, byte row, const __FlashStringHelper* text) {
-  if (clear) lcd.clear();
-  lcd.setCursor(col, row);
-  lcd.print(text);
+// the whole menu screen again, after a game or a message had the display
+void updateMenu() {
+  PROFILE_SCOPE(PROFILE_MENU);
+  mainMenu.draw();
+}
+
+// 'c' on the focused menu line. A game it starts gets a blank screen
+void selectMenuLine() {
+  PROFILE_SCOPE(PROFILE_MENU);
+  mainMenu.select();
+  if (games.active() != GAME_NONE) lcdFb.clear();
 }
 
-void drawProgress(int progress, int howLong) {
-  lbg.drawValue(progress, howLong);
+#if POINT_MODES || MODE_DEFUSAL
+void drawProgress(int progress, int howLong, BarDirection direction = BAR_FORWARD) {
+  PROFILE_SCOPE(PROFILE_BAR_GRAPH);
+  lbg.drawValue(progress, howLong, direction);
 }
+#endif
 
+#if COUNTDOWN_MODES
 void printTime(unsigned long millis, byte col, byte row) {
-  int mins = (millis / 1000L) / 60;
-  int secs = (millis / 1000L) % 60;
-  lcd.setCursor(col, row);
-  if (mins < 10) {
-    lcd.print('0');
+  PROFILE_SCOPE(PROFILE_PRINT_TIME);
+  byte changed = timeShown.follow(millis);
+  bool wide = timeShown.digit(0) != 0;
+  if (!timeCells.drawn || (col != timeCells.col) || (row != timeCells.row) || (wide != timeCells.wide) || (lcdFb.blanked() != timeCells.blanked)) {
+    // somewhere new or wiped, MM:SS or MMM:SS and the two cells after it, which clear the third minute when 100 goes to 99
+    lcdFb.setCursor(col, row);
+    lcdFb.print(wide ? F("   :    ") : F("  :    "));
+    changed = 0xFF;
+    timeCells = { col, row, lcdFb.blanked(), wide, true };
   }
-  lcd.print(mins, DEC);
-  lcd.print(':');
-  if (secs < 10) {
-    lcd.print('0');
+  byte first = wide ? 0 : 1;
+  for (byte i = first; i < BCD_COUNTDOWN_DIGITS; i++) {
+    if (!(changed & (1 << i))) continue;
+    // the seconds are past the colon
+    lcdFb.setCursor(col + i - first + ((i >= 3) ? 1 : 0), row);
+    lcdFb.write('0' + timeShown.digit(i));
   }
-  lcd.print(secs, DEC);
-  // with this we clear whatever was left after minutes went from 100 to 99
-  lcd.print(F("  "));
 }
+#endif
 
-void printDefusalCode(byte col, byte row) {
-  lcd.setCursor(col, row);
-  lcd.print(defusalCode);
+#if POINT_MODES
+// a score at col, row without dividing
+void printScore(unsigned int score, byte col, byte row) {
+  char text[DECIMAL_MAX_LEN + 1];
+  formatDecimal(text, score);
+  lcdFb.setCursor(col, row);
+  lcdFb.print(text);
 }
+#endif
 
-// used to clear user input when a button is pressed on a certain line
-void resetUserInput() {
-  if (mainMenu.get_currentScreen() == &timerScreen) {
-    if (mainMenu.get_focusedLine() == 0) {
-      userInputDelayStr[0] = '\0';
-    } else if (mainMenu.get_focusedLine() == 1) {
-      userInputGameStr[0] = '\0';
-    }
-  } else if (mainMenu.get_currentScreen() == &defusalScreen) {
-    if (mainMenu.get_focusedLine() == 0) {
-      userInputDelayStr[0] = '\0';
-    } else if (mainMenu.get_focusedLine() == 1) {
-      userInputBombStr[0] = '\0';
-    } else if (mainMenu.get_focusedLine() == 2) {
-      memset(userInputCodeStr, 0, sizeof(userInputCodeStr));
-      userCodeInputCount = 0;
-    }
-  }
-  userInputCount = 0;
+#if BIG_COUNTDOWN
+// the time left in digits over both rows, false if it is 100 minutes or more
+bool printBigTime(unsigned long leftMillis) {
+  PROFILE_SCOPE(PROFILE_PRINT_TIME);
+  return bigDigits.drawTime(leftMillis);
+}
+#endif
+
+#if MODE_DEFUSAL
+void printDefusalCode(byte col, byte row) {
+  lcdFb.setCursor(col, row);
+  lcdFb.print(game.defusal.code);
 }
+#endif
 
 // used to clear user input every time a user comes to a screen
 void resetAllInput() {
@@ -177,90 +396,146 @@ void resetAllInput() {
   userInputGameStr[0] = '\0';
   userInputBombStr[0] = '\0';
   userInputCodeStr[0] = '\0';
-  defusalCode[0] = '\0';
-  userInputCount = 0;
+  #if MODE_DEFUSAL
+    game.defusal.code[0] = '\0';
+  #endif
 }
 
-void resetInputPos() {
-  userInputCount = 0;
-  userCodeInputCount = 0;
+// the screen of a mode comes up with what it was last started with
+void loadPreset(GameModeId mode) {
+  resetAllInput();
+  GamePreset preset;
+  if (!presets.load(mode, &preset)) return;
+  // whole fields, the code is compared over all of its bytes, and terminated in case the EEPROM held garbage
+  char* time = (mode == GAME_DEFUSAL) ? userInputBombStr : userInputGameStr;
+  memcpy(userInputDelayStr, preset.delay, MAX_USER_INPUT_LEN);
+  userInputDelayStr[MAX_USER_INPUT_LEN] = '\0';
+  memcpy(time, preset.time, MAX_USER_INPUT_LEN);
+  time[MAX_USER_INPUT_LEN] = '\0';
+  memcpy(userInputCodeStr, preset.code, MAX_CODE_LEN);
+  userInputCodeStr[MAX_CODE_LEN] = '\0';
+}
+
+// written to EEPROM by presets.update() in the background, only the bytes that changed
+void savePreset(GameModeId mode) {
+  GamePreset preset;
+  memset(&preset, 0, sizeof(preset));
+  strcpy(preset.delay, userInputDelayStr);
+  strcpy(preset.time, (mode == GAME_DEFUSAL) ? userInputBombStr : userInputGameStr);
+  strcpy(preset.code, userInputCodeStr);
+  presets.save(mode, &preset);
 }
 
+#if MODE_DEFUSAL
 void resetCodeInput() {
-  memset(defusalCode, 0, sizeof(defusalCode));
+  memset(game.defusal.code, 0, sizeof(game.defusal.code));
   userCodeInputCount = 0;
-  if (isArmed) lcd.setCursor(7, 0);
-  else lcd.setCursor(10, 0);
-  lcd.print(F("      "));
+  if (game.defusal.state == DEFUSAL_ARMED) lcdFb.setCursor(7, 0);
+  else lcdFb.setCursor(10, 0);
+  lcdFb.print(F("      "));
 }
 
+void hideCodeMessage();
+#endif
+
 void stopGames() {
-  timerStarted = false;
-  dominationStarted = false;
-  zoneControlStarted = false;
-  defusalStarted = false;
+  if (games.isRunning()) eventLog.add(LOG_GAME_STOPPED, LOG_NO_TEAM);
+  if (games.active() != GAME_NONE) sync.sendStop(); // only the master's go out
+  games.stop();
+  sound.stopSiren();
+  flags.showingMessage = false;
+}
+
+void startGame(GameModeId mode) {
+  games.start(mode);
+  eventLog.add(LOG_GAME_START, mode);
+  // there is one bomb on the field, the rest is played everywhere. Zone control has no start time
+  if (mode != GAME_DEFUSAL) {
+    SyncStart start = { mode, (unsigned int)atoi(userInputDelayStr), (unsigned int)atoi(userInputGameStr), startedMillis };
+    sync.sendStart(start);
+  }
+}
+
+// winner is the team that won, LOG_NO_TEAM if the mode has none
+void finishGame(byte winner) {
+  games.finish();
+  eventLog.add(LOG_GAME_END, winner);
 }
 
-bool isInGame() {
-  return (timerStarted || dominationStarted || zoneControlStarted || defusalStarted);
+// the game ended on its own and its last screen is still up
+bool isInScoreScreen() {
+  return (games.active() != GAME_NONE) && !games.isRunning();
+}
+
+#if MODE_DEFUSAL
+bool bombArmed() {
+  return (game.defusal.state == DEFUSAL_ARMED) || (game.defusal.state == DEFUSAL_DISARMING);
 }
 
 void verifyDefusalCode() {
   bool codeOk = true;
   for (byte i = 0; i < MAX_CODE_LEN; i++) {
-    if (defusalCode[i] != userInputCodeStr[i]) {
+    if (game.defusal.code[i] != userInputCodeStr[i]) {
       codeOk = false;
       break;
     }
   }
-  if (isArmed) {
+  if (game.defusal.state == DEFUSAL_ARMED) {
     if (codeOk) {
-      isDisarmed = true;
-      isArmed = false;
+      game.defusal.state = DEFUSAL_DISARMED;
+      eventLog.add(LOG_DISARMED, 0);
       printToLcd(true, 4, 0, F("DISARMED"));
       printToLcd(false, 0, 1, F("TIME LEFT:"));
-      printTime(defusalMillis[1]-currMillisDefusal, 10, 1);
-      defusalStarted = false;
-      delay(SIREN_DELAY_TIME);
-      useSiren(true); // disarmed with code, so end the game
+      printTime(game.defusal.bombMillis-game.defusal.elapsedMillis, 10, 1);
+      finishGame(LOG_NO_TEAM);
+      sound.playSiren(delayedEndGameSiren); // disarmed with code, so end the game
     } else {
       printToLcd(false, 0, 0, F("    BAD CODE    "));
-      delay(1000);
-      switch (badCodeCounter) { // for bad codes add some penalties
+      flags.showingMessage = true;
+      // with no slot for the task the keypad would stay locked, the message goes at once instead
+      if (!tasks.runLater(hideCodeMessage, BAD_CODE_TIME)) hideCodeMessage();
+      switch (game.defusal.badCodes) { // for bad codes add some penalties
         case 0:
-          defusalMillis[1] = (defusalMillis[1]-currMillisDefusal) / 2; // first time cut the time in half
-          startedMillis = millis();
+          game.defusal.bombMillis = (game.defusal.bombMillis-game.defusal.elapsedMillis) / 2; // first time cut the time in half
+          startedMillis = Timebase::now();
           break;
         case 1:
-          if ((defusalMillis[1]-currMillisDefusal) > 15000) {
-            defusalMillis[1] = 15000; // second time reduce it to 15 secs
-            startedMillis = millis();
+          if ((game.defusal.bombMillis-game.defusal.elapsedMillis) > 15000) {
+            game.defusal.bombMillis = 15000; // second time reduce it to 15 secs
+            startedMillis = Timebase::now();
           }
           break;
         case 2: // third time bomb goes off
-          defusalMillis[1] = 0;
+          game.defusal.bombMillis = 0;
           break;
       }
-      badCodeCounter++;
-      resetCodeInput();
-      printedLine = false;
+      game.defusal.badCodes++;
+      eventLog.add(LOG_BAD_CODE, game.defusal.badCodes);
     }
   } else {
     if (codeOk) {
-      isArmed = true;
+      game.defusal.state = DEFUSAL_ARMED;
+      eventLog.add(LOG_ARMED, 0);
       resetCodeInput();
-      lcd.clear();
-      startedMillis = millis();
+      lcdFb.clear();
+      startedMillis = Timebase::now();
+      flags.printedLine = false;
     } else {
-      lcd.setCursor(0, 0);
-      lcd.print(F("    BAD CODE    "));
-      delay(1500);
-      resetCodeInput();
+      printToLcd(false, 0, 0, F("    BAD CODE    "));
+      flags.showingMessage = true;
+      if (!tasks.runLater(hideCodeMessage, BAD_ARM_CODE_TIME)) hideCodeMessage();
+      eventLog.add(LOG_BAD_CODE, 0);
     }
-    printedLine = false;
   }
 }
 
+void hideCodeMessage() {
+  flags.showingMessage = false;
+  if (!games.isRunning()) return; // the bomb went off while the message was up
+  resetCodeInput();
+  flags.printedLine = false;
+}
+
 unsigned int getWaitTimeForBeep(unsigned long totalBombMillis, unsigned long passedMillis) {
   /*
     For simplicity's sake I used my own percentages the way I thought it would be good.
@@ -282,126 +557,76 @@ unsigned int getWaitTimeForBeep(unsigned long totalBombMillis, unsigned long pas
  else if ((percPassed <= 20) && (percPassed > 10)) return 1000; // every 1 sec
  else return 200; // 5 times / sec
 }
-
-#if CHECK_BATTERY
-float fmap(float x, float in_min, float in_max, float out_min, float out_max) {
-  return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
-}
 #endif
 
 #if CHECK_BATTERY
-float getBatteryVolts() {
-  int cellInput = analogRead(CELL_PIN);
-  float cellVoltage = fmap(cellInput, 0, 1023, 0.0, MAX_VOLTAGE);
-  // Serial.print("Cell voltage: ");
-  // Serial.println(cellVoltage);
-  // delay(500);
-  return cellVoltage;
+// prints like 3.87V
+void printBatteryVoltage(byte col, byte row) {
+  unsigned int mv = battery.millivolts();
+  byte hundredths = (mv % 1000) / 10;
+  lcdFb.setCursor(col, row);
+  lcdFb.print(mv / 1000);
+  lcdFb.print('.');
+  if (hundredths < 10) lcdFb.print('0');
+  lcdFb.print(hundredths);
+  lcdFb.print('V');
 }
 #endif
 
 #if CHECK_BATTERY
 void checkBattery() {
-  float cellVoltage = getBatteryVolts();
-  if (cellVoltage < 3.40) {
-    lowBattery = true;
-    digitalWrite(CELL_LED, HIGH);
-  }
+  CellLedPin::write(battery.isLow());
+  battery.sample();
 }
 #endif
 //==============================================
-void processInput(char key) {
-  if (userInputCount >= MAX_USER_INPUT_LEN) userInputCount = 0;
-  if (userCodeInputCount >= MAX_CODE_LEN) {
-    memset(userInputCodeStr, 0, sizeof(userInputCodeStr));
-    userCodeInputCount = 0;
-  }
-  
-  if (mainMenu.get_currentScreen() == &timerScreen) {
-    if (mainMenu.get_focusedLine() == 0) {
-      userInputDelayStr[userInputCount] = key;
-      userInputDelayStr[userInputCount+1] = '\0';
-      userInputCount++;
-    } else if (mainMenu.get_focusedLine() == 1) {
-      userInputGameStr[userInputCount] = key;
-      userInputGameStr[userInputCount+1] = '\0';
-      userInputCount++;
-    }
-  } else if (mainMenu.get_currentScreen() == &defusalScreen) {
-    if (mainMenu.get_focusedLine() == 0) {
-      userInputDelayStr[userInputCount] = key;
-      userInputDelayStr[userInputCount+1] = '\0';
-      userInputCount++;
-    } else if (mainMenu.get_focusedLine() == 1) {
-      userInputBombStr[userInputCount] = key;
-      userInputBombStr[userInputCount+1] = '\0';
-      userInputCount++;
-    } else if (mainMenu.get_focusedLine() == 2) {
-      userInputCodeStr[userCodeInputCount] = key;
-      userInputCodeStr[userCodeInputCount+1] = '\0';
-      userCodeInputCount++;
-    }
-  }
-}
-//---------------------
+#if MODE_DEFUSAL
 void processDefusalInput(char key) {
   if (userCodeInputCount >= MAX_CODE_LEN) {
-    memset(defusalCode, 0, sizeof(defusalCode));
+    memset(game.defusal.code, 0, sizeof(game.defusal.code));
     userCodeInputCount = 0;
-    if (isArmed) lcd.setCursor(7, 0);
-    else lcd.setCursor(10, 0);
-    lcd.print(F("      "));
+    if (game.defusal.state == DEFUSAL_ARMED) lcdFb.setCursor(7, 0);
+    else lcdFb.setCursor(10, 0);
+    lcdFb.print(F("      "));
   }
-  defusalCode[userCodeInputCount] = key;
-  defusalCode[userCodeInputCount+1] = '\0';
+  game.defusal.code[userCodeInputCount] = key;
+  game.defusal.code[userCodeInputCount+1] = '\0';
   userCodeInputCount++;
 }
+#endif
 //---------------------
 void processKeypress(char key) {
   if (key != NO_KEY) {
     playKeypress(key);
+    if (games.active() != GAME_NONE) {
+      games.input(key); // the menu keys only work in the menu
+      return;
+    }
     switch (key) {
       case 'a':
-        if (!isInGame() && !isInScoreScreen) {
-          mainMenu.switch_focus(false);
-          resetInputPos();
-        }
+        mainMenu.moveFocus(false);
         break;
       case 'b':
-        if (!isInGame() && !isInScoreScreen) {
-          mainMenu.switch_focus(true);
-          resetInputPos();
-        }
+        mainMenu.moveFocus(true);
         break;
       case 'c':
-        if (!isInGame() && !isInScoreScreen) {
-          if (mainMenu.get_currentScreen() == &mainScreen) {
-            mainMenuLineIdx = mainMenu.get_focusedLine();
-          }
-          mainMenu.call_function(1);
-          useSiren(false);
+        if (mainMenu.screen() == &mainScreen) {
+          mainMenuLineIdx = mainMenu.focused();
         }
+        selectMenuLine();
+        sound.stopSiren();
         break;
       case 'd':
-        if (!isInGame() && !isInScoreScreen) {
-          mainMenu.change_screen(&mainScreen);
-          mainMenu.set_focusedLine(mainMenuLineIdx);
-          stopGames();
-          useSiren(false);
-        }
+        mainMenu.show(&mainScreen, mainMenuLineIdx);
+        stopGames();
         break;
       case '*':
-        if (defusalStarted && (defusalMillis[0] == 0) && useDefusalCode) resetCodeInput();
-        break;
       case '#':
-        if (defusalStarted && (defusalMillis[0] == 0) && useDefusalCode) verifyDefusalCode();
         break;
       default:
-        if (!isInGame() && !isInScoreScreen) processInput(key);
-        if (defusalStarted && (defusalMillis[0] == 0) && useDefusalCode) processDefusalInput(key);
+        mainMenu.type(key); // into the field of the focused line, if it has one
         break;
     }
-    if (!isInGame() && !isInScoreScreen) mainMenu.update();
   }
 }
 //---------------------
@@ -411,29 +636,21 @@ void processHoldKeypress(char key) {
     switch (key) {
       case 'c':
         // reset the game
-        if (!isInGame() && isInScoreScreen) {
-          mainMenu.call_function(1);
-          useSiren(false);
+        if (isInScoreScreen()) {
+          stopGames(); // also silences a siren still waiting to go off
+          selectMenuLine(); // START is still focused, or the mode's line for zone control
         }
         break;
       case 'd':
         // go to main menu
-        if (!isInGame() && isInScoreScreen) {
-          mainMenu.change_screen(&mainScreen);
-          mainMenu.set_focusedLine(mainMenuLineIdx);
-          mainMenu.update();
+        if (isInScoreScreen()) {
+          mainMenu.show(&mainScreen, mainMenuLineIdx);
           stopGames();
-          useSiren(false);
-          isInScoreScreen = false;
         } else {
           for (int i = 0; i < LIST_MAX; i++) {
             if ((kpd.key[i].kchar == '*') && (kpd.key[i].kstate == HOLD)) {
-              mainMenu.change_screen(&mainScreen);
-              mainMenu.set_focusedLine(mainMenuLineIdx);
               stopGames();
-              useSiren(false);
-              mainMenu.update();
-              isInScoreScreen = false;
+              mainMenu.show(&mainScreen, mainMenuLineIdx);
             }
           }
         }
@@ -443,6 +660,9 @@ void processHoldKeypress(char key) {
 }
 //---------------------
 void keypadEvent(KeypadEvent key) {
+  // the key that lights the display up does nothing else
+  if (power.activity() && (kpd.getState() == PRESSED)) return;
+  if (flags.showingMessage) return;
   switch (kpd.getState()) {
     case IDLE:
       break;
@@ -460,306 +680,772 @@ void keypadEvent(KeypadEvent key) {
   }
 }
 //==============================================
-// callback function, only setup variables here
+void hideInvalidInput() {
+  flags.showingMessage = false;
+  mainMenu.focus(invalidInputLine);
+  updateMenu();
+}
+
+void showInvalidInput() {
+  printToLcd(true, 0, 0, F("*INVALID INPUT*"));
+  printToLcd(false, 1, 1, invalidInputText);
+  if (!tasks.runLater(hideInvalidInput, INVALID_INPUT_TIME)) hideInvalidInput();
+}
+
+// called from menu actions, the message is drawn on the next pass of loop()
+void rejectInput(const __FlashStringHelper* text, byte line) {
+  invalidInputText = text;
+  invalidInputLine = line;
+  flags.showingMessage = true;
+  // no slot, no message: back to the menu rather than a keypad locked for good
+  if (!tasks.runLater(showInvalidInput, 0)) hideInvalidInput();
+}
+//==============================================
+#if MODE_DEFUSAL
+// menu callback, the game itself is set up in enterDefusal()
 void startDefusal() {
   if (atoi(userInputBombStr) == 0) {
-    printToLcd(true, 0, 0, F("*INVALID INPUT*"));
-    printToLcd(false, 1, 1, F("* BOMB TIME *"));
-    delay(3000);
-    mainMenu.set_focusedLine(1);
+    rejectInput(F("* BOMB TIME *"), 1);
     return;
   }
-  // we don't swap values in this mode, only in domination and timer
-  defusalMillis[0] = (atoi(userInputDelayStr) * 1000L) * 60; // delay time
-  defusalMillis[1] = (atoi(userInputBombStr) * 1000L) * 60; // bomb time
+  savePreset(GAME_DEFUSAL);
+  startGame(GAME_DEFUSAL);
+}
+//---------------------
+void enterDefusal() {
+  game.defusal.delayMillis = (atoi(userInputDelayStr) * 1000L) * 60;
+  game.defusal.bombMillis = (atoi(userInputBombStr) * 1000L) * 60;
+  game.defusal.elapsedMillis = 0;
+  game.defusal.state = (game.defusal.delayMillis > 0) ? DEFUSAL_DELAY : DEFUSAL_READY;
   resetCodeInput();
-  useDefusalCode = (userInputCodeStr[0] != '\0');
-  startedMillis = 0;
-  lastMillis = 0;
-  badCodeCounter = 0;
+  game.defusal.useCode = (userInputCodeStr[0] != '\0');
+  game.defusal.ignoreButtons = false;
+  startedMillis = TIME_UNSET;
+  lastMillis = TIME_UNSET;
+  game.defusal.lastBeepMillis = TIME_UNSET;
+  game.defusal.badCodes = 0;
   userCodeInputCount = 0;
-  printedLine = false;
-  isArmed = false;
-  isArming = false;
-  isDisarmed = false;
-  isDisarming = false;
-  defusalStarted = true;
-  isInScoreScreen = true;
+  flags.printedLine = false;
 }
 //---------------------
 void updateDefusal() {
-  if (defusalMillis[0] > 0) { // delay time was entered
-    if (startedMillis == 0) startedMillis = millis();
-    unsigned long currMillis = millis() - startedMillis;
-    if ((millis() - lastMillis) >= 1000) { // don't need to re-draw more than once per second
-      lastMillis = millis();
-      if (!printedLine) {
+  PROFILE_SCOPE(PROFILE_DEFUSAL);
+  if (game.defusal.state == DEFUSAL_DELAY) {
+    if (startedMillis == TIME_UNSET) startedMillis = Timebase::now();
+    unsigned long currMillis = Timebase::since(startedMillis);
+    if (Timebase::passed(lastMillis, 1000)) { // don't need to re-draw more than once per second
+      lastMillis = Timebase::now();
+      if (!flags.printedLine) {
         printToLcd(true, 1, 0, F("PREP FOR GAME"));
-        printedLine = true;
+        flags.printedLine = true;
       }
-      if (currMillis >= defusalMillis[0]) {
-        defusalMillis[0] = 0;
-        startedMillis = 0;
-        printedLine = false;
-        useSiren(true);
+      if (currMillis >= game.defusal.delayMillis) {
+        game.defusal.state = DEFUSAL_READY;
+        startedMillis = TIME_UNSET;
+        flags.printedLine = false;
+        sound.playSiren(startGameSiren);
       } else {
-        printTime((defusalMillis[0]-currMillis), 5, 1);
+        printTime((game.defusal.delayMillis-currMillis), 5, 1);
       }
     }
   } else {
-    currMillisDefusal = millis() - startedMillis;
+    game.defusal.elapsedMillis = (startedMillis == TIME_UNSET) ? 0 : Timebase::since(startedMillis);
+    bool holding = (game.defusal.state == DEFUSAL_ARMING) || (game.defusal.state == DEFUSAL_DISARMING);
     // if code is used, we need to update the screen more often
-    if (((millis() - lastMillis) >= ((useDefusalCode) ? 100 : 1000)) && (useDefusalCode || (!isArming && !isDisarming))) {
-      lastMillis = millis();
-      if (!isArmed && !isDisarmed) {
-        if (useDefusalCode) {
-          if (!printedLine) {
+    if (Timebase::passed(lastMillis, (game.defusal.useCode) ? 100 : 1000) && (game.defusal.useCode || !holding)) {
+      lastMillis = Timebase::now();
+      bool bigTime = false;
+      if (game.defusal.state == DEFUSAL_READY) {
+        if (game.defusal.useCode) {
+          if (!flags.printedLine) {
             printToLcd(false, 0, 0, F("ARM CODE:       "));
-            printedLine = true;
+            flags.printedLine = true;
           }
-          printDefusalCode(10, 0);
+          if (!flags.showingMessage) printDefusalCode(10, 0);
         } else {
-          if (!printedLine) {
+          if (!flags.printedLine) {
             printToLcd(false, 0, 0, F("     READY      "));
-            printedLine = true;
+            flags.printedLine = true;
           }
         }
-        printTime(defusalMillis[1], 10, 1);
-      } else if (isDisarmed) {
+        printTime(game.defusal.bombMillis, 10, 1);
+      } else if (game.defusal.state == DEFUSAL_DISARMED) {
         printToLcd(true, 4, 0, F("DISARMED"));
         printToLcd(false, 0, 1, F("TIME LEFT:"));
-        printTime(defusalMillis[1]-currMillisDefusal, 10, 1);
-        defusalStarted = false;
-        delay(SIREN_DELAY_TIME);
-        useSiren(true); // end the game when disarmed with buttons
-      } else if (isArmed) {
-        if (useDefusalCode) {
-          if (!printedLine) {
+        printTime(game.defusal.bombMillis-game.defusal.elapsedMillis, 10, 1);
+        finishGame(LOG_NO_TEAM);
+        sound.playSiren(delayedEndGameSiren); // end the game when disarmed with buttons
+      } else if (game.defusal.state == DEFUSAL_ARMED) {
+        unsigned long left = game.defusal.bombMillis-game.defusal.elapsedMillis;
+        if (game.defusal.useCode) {
+          if (!flags.printedLine) {
             printToLcd(false, 0, 0, F("ARMED: "));
-            printedLine = true;
+            flags.printedLine = true;
           }
-          printDefusalCode(7, 0);
+          if (!flags.showingMessage) printDefusalCode(7, 0);
         } else {
-          if (!printedLine) {
+          #if BIG_COUNTDOWN
+            bigTime = printBigTime(left); // nothing to type, the whole screen counts down
+          #endif
+          if (!bigTime && !flags.printedLine) {
             printToLcd(false, 0, 0, F("     ARMED      "));
-            printedLine = true;
+            flags.printedLine = true;
           }
         }
-        printTime(defusalMillis[1]-currMillisDefusal, 10, 1);
+        if (!bigTime) printTime(left, 10, 1);
       }
-      printToLcd(false, 0, 1, F("TIME LEFT:"));
+      if (!bigTime) printToLcd(false, 0, 1, F("TIME LEFT:"));
     }
-    if (isArmed && (currMillisDefusal > defusalMillis[1])) {
+    if (bombArmed() && (game.defusal.elapsedMillis > game.defusal.bombMillis)) {
+      game.defusal.state = DEFUSAL_EXPLODED;
+      eventLog.add(LOG_EXPLODED, LOG_NO_TEAM);
       printToLcd(true, 4, 0, F("EXPLODED"));
       printToLcd(false, 0, 1, F("TIME LEFT:00:00"));
-      defusalStarted = false;
-      delay(SIREN_DELAY_TIME);
-      useSiren(true); // end the game when time runs out
+      finishGame(LOG_NO_TEAM);
+      sound.playSiren(delayedEndGameSiren); // end the game when time runs out
     }
-    if (defusalStarted && isArmed) {
-      if (!useDefusalCode && (lastBeepMillis == 0)) { // skip first beep when the bomb has just been planted with buttons
-        lastBeepMillis = millis();
+    if (bombArmed()) {
+      if (!game.defusal.useCode && (game.defusal.lastBeepMillis == TIME_UNSET)) { // skip first beep when the bomb has just been planted with buttons
+        game.defusal.lastBeepMillis = Timebase::now();
         return;
       }
-      unsigned int waitTime = getWaitTimeForBeep(defusalMillis[1], currMillisDefusal);
-      if ((millis() - lastBeepMillis) > waitTime) {
-        lastBeepMillis = millis();
-        tone(BUZZER_PIN, BEEP_TONE, 125); // 125 millis is the same as in CSGO, apparently
+      unsigned int waitTime = getWaitTimeForBeep(game.defusal.bombMillis, game.defusal.elapsedMillis);
+      if (Timebase::since(game.defusal.lastBeepMillis) > waitTime) {
+        game.defusal.lastBeepMillis = Timebase::now();
+        sound.play(bombBeepSound);
       }
     }
   }
 }
 //---------------------
+// the code is typed in once the delay is over
+void defusalInput(char key) {
+  if ((game.defusal.state == DEFUSAL_DELAY) || !game.defusal.useCode) return;
+  switch (key) {
+    case '*':
+      resetCodeInput();
+      break;
+    case '#':
+      verifyDefusalCode();
+      break;
+    case 'a':
+    case 'b':
+    case 'c':
+    case 'd':
+      break;
+    default:
+      processDefusalInput(key);
+      break;
+  }
+}
+//---------------------
+void exitDefusal() {
+  tasks.cancel(hideCodeMessage);
+}
+//---------------------
 void defusal() {
-  startLine.attach_function(1, startDefusal);
-  resetAllInput();
-  mainMenu.change_screen(&defusalScreen);
-  mainMenu.set_focusedLine(0);
-  mainMenu.update();
+  loadPreset(GAME_DEFUSAL);
+  mainMenu.show(&defusalScreen, 0);
 }
+#endif
 //==============================================
-// callback function, only setup variables here
+#if POINT_MODES
+void resetPoint(PointScore& point) {
+  point.score[0] = 0;
+  point.score[1] = 0;
+  point.owner = NO_TEAM;
+  sync.setOwner(NO_TEAM);
+}
+
+// a second of holding the point is worth a point
+void scorePoint(PointScore& point) {
+  if (point.owner != NO_TEAM) point.score[point.owner]++;
+}
+
+CaptureResult updateCapture(unsigned long now, PointScore& point, bool barShown);
+#endif
+//---------------------
+#if MODE_DOMINATION
+// menu callback, the game itself is set up in enterDomination()
 void startDomination() {
-  printedLine = false;
-  showScore = false;
-  dominationScore[0] = 0;
-  dominationScore[1] = 0;
-  teamScoreSwitcher[0] = false;
-  teamScoreSwitcher[1] = false;
-  lastMillis = 0;
-  timerMillis[0] = (atoi(userInputDelayStr) * 1000L) * 60; // this holds the time to compare to
-  timerMillis[1] = (atoi(userInputGameStr) * 1000L) * 60; // this holds next time to count
-  if (timerMillis[1] == 0) {
-    printToLcd(true, 0, 0, F("*INVALID INPUT*"));
-    printToLcd(false, 1, 1, F("* GAME TIME *"));
-    delay(3000);
-    mainMenu.set_focusedLine(1);
-  } else {
-    dominationStarted = true;
-    isInScoreScreen = true;
+  if (atoi(userInputGameStr) == 0) {
+    rejectInput(F("* GAME TIME *"), 1);
+    return;
   }
-  startedMillis = millis();
+  savePreset(GAME_DOMINATION);
+  startGame(GAME_DOMINATION);
+}
+//---------------------
+void enterDomination() {
+  game.domination.state = DOMINATION_DELAY;
+  flags.printedLine = false;
+  resetPoint(game.domination.point);
+  lastMillis = TIME_UNSET;
+  game.domination.phaseMillis[0] = (atoi(userInputDelayStr) * 1000L) * 60; // this holds the time to compare to
+  game.domination.phaseMillis[1] = (atoi(userInputGameStr) * 1000L) * 60; // this holds next time to count
+  startedMillis = Timebase::now();
+}
+//---------------------
+byte dominationWinner() {
+  const PointScore& point = game.domination.point;
+  if (point.score[0] == point.score[1]) return LOG_NO_TEAM;
+  return (point.score[0] > point.score[1]) ? 0 : 1;
 }
 //---------------------
 void updateDomination() {
-  unsigned long currMillis = millis() - startedMillis;
-  if (currMillis >= timerMillis[0]) {
-    if (timerMillis[1] == 0) {
-      dominationStarted = false;
+  PROFILE_SCOPE(PROFILE_DOMINATION);
+  unsigned long currMillis = Timebase::since(startedMillis);
+  if (currMillis >= game.domination.phaseMillis[0]) {
+    if (game.domination.state != DOMINATION_DELAY) {
+      finishGame(dominationWinner());
       printToLcd(false, 0, 0, F("DOMINATION ENDED"));
-      useSiren(true); // end the game
+      sound.playSiren(endGameSiren); // end the game
     } else {
-      if (timerMillis[0] > 0) useSiren(true); // start the game
-      timerMillis[0] = timerMillis[1];
-      timerMillis[1] = 0;
-      showScore = true;
-      lcd.clear();
-      startedMillis = millis();
+      if (game.domination.phaseMillis[0] > 0) sound.playSiren(startGameSiren); // start the game
+      game.domination.phaseMillis[0] = game.domination.phaseMillis[1];
+      game.domination.state = DOMINATION_SCORING;
+      lcdFb.clear();
+      startedMillis = Timebase::now();
     }
-  } else if ((millis() - lastMillis) >= 1000) {
-    lastMillis = millis();
-    if (!showScore) {
-      if (!printedLine) {
+  } else if (Timebase::passed(lastMillis, 1000)) {
+    lastMillis = Timebase::now();
+    if (game.domination.state == DOMINATION_DELAY) {
+      if (!flags.printedLine) {
         printToLcd(true, 1, 0, F("PREP FOR GAME"));
-        printedLine = true;
+        flags.printedLine = true;
       }
-      printTime((timerMillis[0]-currMillis), 5, 1);
+      printTime((game.domination.phaseMillis[0]-currMillis), 5, 1);
     } else {
-      if (teamScoreSwitcher[0]) dominationScore[0]++;
-      if (teamScoreSwitcher[1]) dominationScore[1]++;
+      scorePoint(game.domination.point);
       printToLcd(false, 0, 0, F("TIME LEFT:"));
-      printTime((timerMillis[0]-currMillis), 10, 0);
-      if (!isDisarming) { // only print score if progressbar isn't showing
+      printTime((game.domination.phaseMillis[0]-currMillis), 10, 0);
+      if (game.domination.state != DOMINATION_CAPTURING) { // only print score if progressbar isn't showing
         printToLcd(false, 0, 1, F("T1:      ")); // need to print with spaces to clear progress left-overs
         printToLcd(false, 9, 1, F("T2:    "));
-        lcd.setCursor(3, 1);
-        lcd.print(dominationScore[0], DEC);
-        lcd.setCursor(12, 1);
-        lcd.print(dominationScore[1], DEC);
+        printScore(game.domination.point.score[0], 3, 1);
+        printScore(game.domination.point.score[1], 12, 1);
       }
     }
   }
 }
 //---------------------
+void dominationButtons(unsigned long now) {
+  if (game.domination.state == DOMINATION_DELAY) {
+    holdFloorMillis = now;
+    return;
+  }
+  CaptureResult result = updateCapture(now, game.domination.point, game.domination.state == DOMINATION_CAPTURING);
+  game.domination.state = (result == CAPTURE_HOLDING) ? DOMINATION_CAPTURING : DOMINATION_SCORING;
+}
+//---------------------
 void domination() {
-  // we re-use the same input interface from timer to save space, only change the callback
-  startLine.attach_function(1, startDomination);
-  resetAllInput();
-  mainMenu.change_screen(&timerScreen);
-  mainMenu.set_focusedLine(0);
-  mainMenu.update();
+  loadPreset(GAME_DOMINATION);
+  mainMenu.show(&dominationScreen, 0);
 }
+#endif
 //==============================================
-// callback function, only setup variables here
+#if MODE_ZONE_CONTROL
+// menu callback, zone control has nothing to set
 void startZoneControl() {
-  printedLine = false;
-  isInScoreScreen = true;
-  lastMillis = 0;
-  dominationScore[0] = 0;
-  dominationScore[1] = 0;
-  teamScoreSwitcher[0] = false;
-  teamScoreSwitcher[1] = false;
-  zoneControlStarted = true;
+  startGame(GAME_ZONE_CONTROL);
+}
+//---------------------
+void enterZoneControl() {
+  game.zoneControl.state = ZONE_SCORING;
+  flags.printedLine = false;
+  lastMillis = TIME_UNSET;
+  resetPoint(game.zoneControl.point);
 }
 //---------------------
 void updateZoneControl() {
-  if ((millis() - lastMillis) >= 1000) {
-    lastMillis = millis();
-    if (teamScoreSwitcher[0]) dominationScore[0]++;
-    if (teamScoreSwitcher[1]) dominationScore[1]++;
-    if (!isDisarming) { // only print score if progressbar isn't showing
-      if (!printedLine) {
+  PROFILE_SCOPE(PROFILE_ZONE_CONTROL);
+  if (Timebase::passed(lastMillis, 1000)) {
+    lastMillis = Timebase::now();
+    scorePoint(game.zoneControl.point);
+    if (game.zoneControl.state != ZONE_CAPTURING) { // only print score if progressbar isn't showing
+      if (!flags.printedLine) {
         printToLcd(true, 0, 0, F("TEAM 1:"));
         printToLcd(false, 9, 0, F("TEAM 2:"));
-        printedLine = true;
+        flags.printedLine = true;
       }
-      lcd.setCursor(0, 1);
-      lcd.print(dominationScore[0], DEC);
-      lcd.setCursor(9, 1);
-      lcd.print(dominationScore[1], DEC);
+      printScore(game.zoneControl.point.score[0], 0, 1);
+      printScore(game.zoneControl.point.score[1], 9, 1);
     } else {
-      if (!printedLine) {
+      if (!flags.printedLine) {
         printToLcd(false, 3, 0, F("CAPTURING"));
-        printedLine = true;
+        flags.printedLine = true;
       }
     }
   }
 }
 //---------------------
-void zoneControl() {
-  // empty, only keep this for pretty format
+void zoneControlButtons(unsigned long now) {
+  CaptureResult result = updateCapture(now, game.zoneControl.point, game.zoneControl.state == ZONE_CAPTURING);
+  if (result != CAPTURE_IDLE) flags.printedLine = false;
+  game.zoneControl.state = (result == CAPTURE_HOLDING) ? ZONE_CAPTURING : ZONE_SCORING;
 }
+#endif
 //==============================================
-// callback function, only setup variables here
+#if MODE_TIMER
+// menu callback, the game itself is set up in enterTimer()
 void startTimer() {
-  printedLine = false;
-  lastMillis = 0;
-  timerMillis[0] = (atoi(userInputDelayStr) * 1000L) * 60; // this holds the time to compare to
-  timerMillis[1] = (atoi(userInputGameStr) * 1000L) * 60; // this holds next time to count
-  if ((timerMillis[0] == 0) || timerMillis[1] == 0) {
-    printToLcd(true, 0, 0, F("*INVALID INPUT*"));
-    if (timerMillis[0] == 0) {
-      printToLcd(false, 1, 1, F("* DELAY TIME *"));
-      mainMenu.set_focusedLine(0);
-    } else if (timerMillis[1] == 0) {
-      printToLcd(false, 1, 1, F("* GAME TIME *"));
-      mainMenu.set_focusedLine(1);
-    }
-    delay(3000);
+  if (atoi(userInputDelayStr) == 0) {
+    rejectInput(F("* DELAY TIME *"), 0);
+  } else if (atoi(userInputGameStr) == 0) {
+    rejectInput(F("* GAME TIME *"), 1);
   } else {
-    timerStarted = true;
-    isInScoreScreen = true;
+    savePreset(GAME_TIMER);
+    startGame(GAME_TIMER);
   }
-  startedMillis = millis();
+}
+//---------------------
+void enterTimer() {
+  game.timer.state = TIMER_DELAY;
+  flags.printedLine = false;
+  lastMillis = TIME_UNSET;
+  game.timer.phaseMillis[0] = (atoi(userInputDelayStr) * 1000L) * 60; // this holds the time to compare to
+  game.timer.phaseMillis[1] = (atoi(userInputGameStr) * 1000L) * 60; // this holds next time to count
+  startedMillis = Timebase::now();
 }
 //---------------------
 void updateTimer() {
-  unsigned long currMillis = millis() - startedMillis;
-  if (currMillis >= timerMillis[0]) {
-    if (timerMillis[1] == 0) {
-      timerStarted = false;
+  PROFILE_SCOPE(PROFILE_TIMER);
+  unsigned long currMillis = Timebase::since(startedMillis);
+  if (currMillis >= game.timer.phaseMillis[0]) {
+    if (game.timer.state == TIMER_GAME) {
+      finishGame(LOG_NO_TEAM);
       printToLcd(true, 3, 0, F("GAME ENDED"));
-      useSiren(true);
+      sound.playSiren(endGameSiren);
     } else {
       printToLcd(true, 2, 0, F("GAME STARTED"));
-      timerMillis[0] = timerMillis[1];
-      timerMillis[1] = 0;
-      startedMillis = millis();
-      useSiren(true);
+      game.timer.phaseMillis[0] = game.timer.phaseMillis[1];
+      game.timer.state = TIMER_GAME;
+      startedMillis = Timebase::now();
+      sound.playSiren(startGameSiren);
     }
-  } else if ((millis() - lastMillis) >= 1000) {
-    lastMillis = millis();
-    if (!printedLine) {
+  } else if (Timebase::passed(lastMillis, 1000)) {
+    lastMillis = Timebase::now();
+    #if BIG_COUNTDOWN
+      if ((game.timer.state == TIMER_GAME) && printBigTime(game.timer.phaseMillis[0]-currMillis)) return;
+    #endif
+    if (!flags.printedLine) {
       printToLcd(true, 1, 0, F("PREP FOR GAME"));
-      printedLine = true;
+      flags.printedLine = true;
     }
-    printTime((timerMillis[0]-currMillis), 5, 1);
+    printTime((game.timer.phaseMillis[0]-currMillis), 5, 1);
   }
 }
 //---------------------
 void timer() {
-  // attach callback here because we use the same interface for domination
-  startLine.attach_function(1, startTimer);
-  resetAllInput();
-  mainMenu.change_screen(&timerScreen);
-  mainMenu.set_focusedLine(0);
-  mainMenu.update();
+  loadPreset(GAME_TIMER);
+  mainMenu.show(&timerScreen, 0);
 }
+#endif
 //==============================================
+bool anyBtnHeld() {
+  return flags.heldButtons != 0;
+}
+
+void startHold(unsigned long pressedMillis) {
+  // wrap safe "later of the two"
+  currMillisLoop = ((long)(pressedMillis - holdFloorMillis) > 0) ? pressedMillis : holdFloorMillis;
+}
+
+// how long the hold on screen lasted at now. A press stamped by the button interrupt can be
+// later than the now a pass started with, that is no time held and not 49 days
+unsigned long heldMillis(unsigned long now) {
+  return ((long)(now - currMillisLoop) > 0) ? (now - currMillisLoop) : 0;
+}
+
+void endHold(unsigned long now) {
+  currMillisLoop = TIME_UNSET;
+  holdFloorMillis = now;
+}
+
+#if POINT_MODES
+// team captures in domination and zone control, barShown tells if the last pass left the progress bar up
+CaptureResult updateCapture(unsigned long now, PointScore& point, bool barShown) {
+  byte team;
+  if ((flags.heldButtons & 0x01) && (point.owner != 0)) {
+    team = 0;
+  } else if ((flags.heldButtons & 0x02) && (point.owner != 1)) {
+    team = 1;
+  } else { // if both buttons are not pressed
+    if (barShown) lastMillis = TIME_UNSET; // show score immediately
+    endHold(now);
+    return CAPTURE_IDLE;
+  }
+  if (currMillisLoop == TIME_UNSET) startHold(btnPressedMillis[team]);
+  unsigned long millisDiff = heldMillis(now);
+  if (!barShown) {
+    lcdFb.clear();
+    lastMillis = TIME_UNSET; // show time immediately
+  }
+  drawProgress(millisDiff, TEAM_SWITCH_TIME, (team == 0) ? BAR_FORWARD : BAR_REVERSE); // from the team's side
+  if (millisDiff >= TEAM_SWITCH_TIME) {
+    lastMillis = TIME_UNSET; // show score immediately
+    endHold(now);
+    point.owner = team;
+    sync.setOwner(team);
+    eventLog.add(LOG_TEAM_SWITCH, team);
+    sound.play(chirpSound);
+    return CAPTURE_TAKEN;
+  }
+  return CAPTURE_HOLDING;
+}
+#endif
+
+#if MODE_DEFUSAL
+// arming and defusing with the buttons in defusal
+void updateBombButtons(unsigned long now) {
+  if (game.defusal.state == DEFUSAL_DELAY) {
+    holdFloorMillis = now;
+    return;
+  }
+  if (game.defusal.ignoreButtons) {
+    // check if button was released after planting the bomb to not start defusing immediately if someone keeps holding the button
+    game.defusal.ignoreButtons = anyBtnHeld();
+  }
+  // use any of two buttons to arm and defuse
+  if (!game.defusal.ignoreButtons && !game.defusal.useCode && anyBtnHeld()) {
+    if (currMillisLoop == TIME_UNSET) {
+      startHold(anyBtnPressedMillis);
+      lcdFb.clear();
+    }
+    unsigned long millisDiff = heldMillis(now);
+    if ((game.defusal.state == DEFUSAL_READY) || (game.defusal.state == DEFUSAL_ARMING)) {
+      game.defusal.state = DEFUSAL_ARMING;
+      printToLcd(false, 5, 0, F("ARMING"));
+      drawProgress(millisDiff, BOMB_ARM_TIME);
+      flags.printedLine = false;
+      if (millisDiff >= BOMB_ARM_TIME) {
+        game.defusal.state = DEFUSAL_ARMED;
+        eventLog.add(LOG_ARMED, 1);
+        lcdFb.clear();
+        sound.play(chirpSound);
+        startedMillis = now;
+        endHold(now);
+        game.defusal.ignoreButtons = anyBtnHeld();
+      }
+    } else if (bombArmed()) {
+      game.defusal.state = DEFUSAL_DISARMING;
+      printToLcd(false, 0, 0, F("DISARMING"));
+      printTime(game.defusal.bombMillis-game.defusal.elapsedMillis, 10, 0);
+      drawProgress(millisDiff, BOMB_DEFUSE_TIME);
+      flags.printedLine = false;
+      if (millisDiff >= BOMB_DEFUSE_TIME) {
+        game.defusal.state = DEFUSAL_DISARMED;
+        eventLog.add(LOG_DISARMED, 1);
+        lcdFb.clear();
+      }
+    }
+  } else {
+    if (game.defusal.state == DEFUSAL_ARMING) game.defusal.state = DEFUSAL_READY;
+    if (game.defusal.state == DEFUSAL_DISARMING) game.defusal.state = DEFUSAL_ARMED;
+    endHold(now);
+  }
+}
+#endif
+
+// now is the time of the button event being handled, or Timebase::now() once they are all in
+void updateButtonHolds(unsigned long now) {
+  if (!games.isRunning()) holdFloorMillis = now; // a button held since the menu doesn't count
+  games.buttons(now);
+}
+
+void handleButtonEvent(const ButtonEvent& event) {
+  power.activity(); // the buttons work in the dark too, a hold must not lose its first press
+  if (event.type == BUTTON_PRESSED) {
+    if (!anyBtnHeld()) anyBtnPressedMillis = event.time;
+    flags.heldButtons |= (1 << event.button);
+    btnPressedMillis[event.button] = event.time;
+  } else {
+    // a hold that was long enough still counts, even if loop() only gets to its release now
+    updateButtonHolds(event.time);
+    flags.heldButtons &= ~(1 << event.button);
+  }
+}
+//==============================================
+// a game the master started, played on its settings and clock
+void syncedStart(const SyncStart& start) {
+  if ((start.mode == GAME_DEFUSAL) || (start.mode >= GAME_MODES) || !(builtModes & (1 << start.mode))) return;
+  if ((start.delayMinutes > 999) || (start.gameMinutes > 999)) return; // the inputs take 3 digits
+  stopGames();
+  // the screens the menu would have gone through, for resetting and leaving the game later
+  #if MODE_ZONE_CONTROL
+    if (start.mode == GAME_ZONE_CONTROL) {
+      mainMenuLineIdx = LINE_ZONE_CONTROL;
+      mainMenu.show(&mainScreen, mainMenuLineIdx);
+    }
+  #endif
+  #if MODE_DOMINATION
+    if (start.mode == GAME_DOMINATION) {
+      mainMenuLineIdx = LINE_DOMINATION;
+      mainMenu.show(&dominationScreen, TIME_SCREEN_START);
+    }
+  #endif
+  #if MODE_TIMER
+    if (start.mode == GAME_TIMER) {
+      mainMenuLineIdx = LINE_TIMER;
+      mainMenu.show(&timerScreen, TIME_SCREEN_START);
+    }
+  #endif
+  itoa(start.delayMinutes, userInputDelayStr, 10);
+  itoa(start.gameMinutes, userInputGameStr, 10);
+  startGame((GameModeId)start.mode);
+  lcdFb.clear();
+  startedMillis = start.at;
+  power.activity();
+}
+
+// the master went back to the menu
+void syncedStop() {
+  if (games.active() == GAME_NONE) return;
+  stopGames();
+  mainMenu.show(&mainScreen, mainMenuLineIdx);
+}
+
+// ms left of a phase this long that started at startedMillis
+unsigned long timeLeft(unsigned long length) {
+  if (startedMillis == TIME_UNSET) return length;
+  unsigned long passed = Timebase::since(startedMillis);
+  return (passed < length) ? (length - passed) : 0;
+}
+
+// what the referee sees of this prop, sent over the bus by sync
+void fillTelemetry(Telemetry& snapshot) {
+  memset(&snapshot, 0, sizeof(snapshot));
+  snapshot.mode = games.active();
+  snapshot.owner = NO_TEAM;
+  if (games.isRunning()) snapshot.flags |= TELEMETRY_RUNNING;
+  if (sound.isSirenPlaying()) snapshot.flags |= TELEMETRY_SIREN;
+  if (flags.heldButtons & 0x01) snapshot.flags |= TELEMETRY_T1_HELD;
+  if (flags.heldButtons & 0x02) snapshot.flags |= TELEMETRY_T2_HELD;
+  const PointScore* point = NULL;
+  unsigned long holdTime = TEAM_SWITCH_TIME;
+  switch (snapshot.mode) {
+    #if MODE_TIMER
+      case GAME_TIMER:
+        snapshot.phase = game.timer.state;
+        snapshot.remaining = timeLeft(game.timer.phaseMillis[0]);
+        break;
+    #endif
+    #if MODE_DOMINATION
+      case GAME_DOMINATION:
+        snapshot.phase = game.domination.state;
+        snapshot.remaining = timeLeft(game.domination.phaseMillis[0]);
+        point = &game.domination.point;
+        break;
+    #endif
+    #if MODE_ZONE_CONTROL
+      case GAME_ZONE_CONTROL:
+        snapshot.phase = game.zoneControl.state;
+        point = &game.zoneControl.point;
+        break;
+    #endif
+    #if MODE_DEFUSAL
+      case GAME_DEFUSAL:
+        snapshot.phase = game.defusal.state;
+        if (game.defusal.state == DEFUSAL_DELAY) snapshot.remaining = timeLeft(game.defusal.delayMillis);
+        else if (bombArmed()) snapshot.remaining = timeLeft(game.defusal.bombMillis);
+        else if (game.defusal.state < DEFUSAL_ARMED) snapshot.remaining = game.defusal.bombMillis; // not ticking yet
+        holdTime = bombArmed() ? BOMB_DEFUSE_TIME : BOMB_ARM_TIME;
+        break;
+    #endif
+  }
+  if (point != NULL) {
+    snapshot.score[0] = point->score[0];
+    snapshot.score[1] = point->score[1];
+    snapshot.owner = point->owner;
+  }
+  if (!games.isRunning()) {
+    snapshot.remaining = 0;
+  } else if (currMillisLoop != TIME_UNSET) {
+    unsigned long held = heldMillis(Timebase::now());
+    snapshot.progress = (held >= holdTime) ? 255 : (held * 255 / holdTime);
+  }
+}
+//==============================================
+// handlers of the game modes, in the order of GameModeId. A mode that isn't built has none
+// for the event log, which prints the number of a mode without a name
+#if MODE_TIMER
+  const char timerName[] PROGMEM = "timer";
+#else
+  #define timerName NULL
+#endif
+#if MODE_DOMINATION
+  const char dominationName[] PROGMEM = "domination";
+#else
+  #define dominationName NULL
+#endif
+#if MODE_ZONE_CONTROL
+  const char zoneControlName[] PROGMEM = "zone control";
+#else
+  #define zoneControlName NULL
+#endif
+#if MODE_DEFUSAL
+  const char defusalName[] PROGMEM = "defusal";
+#else
+  #define defusalName NULL
+#endif
+const char* const gameModeNames[GAME_MODES] PROGMEM = { timerName, dominationName, zoneControlName, defusalName };
+
+const GameMode gameModes[GAME_MODES] PROGMEM = {
+  // enter, update, input, buttons, exit
+  #if MODE_TIMER
+    { enterTimer, updateTimer, NULL, NULL, NULL },
+  #else
+    { NULL, NULL, NULL, NULL, NULL },
+  #endif
+  #if MODE_DOMINATION
+    { enterDomination, updateDomination, NULL, dominationButtons, NULL },
+  #else
+    { NULL, NULL, NULL, NULL, NULL },
+  #endif
+  #if MODE_ZONE_CONTROL
+    { enterZoneControl, updateZoneControl, NULL, zoneControlButtons, NULL },
+  #else
+    { NULL, NULL, NULL, NULL, NULL },
+  #endif
+  #if MODE_DEFUSAL
+    { enterDefusal, updateDefusal, defusalInput, updateBombButtons, exitDefusal }
+  #else
+    { NULL, NULL, NULL, NULL, NULL }
+  #endif
+};
+//==============================================
+#if LOOP_PROFILER
+// true once when 'a' and 'b' are down together. Only the first key of a chord
+// reaches keypadEvent(), so the 'b' does nothing else
+bool profileChordPressed() {
+  static bool wasDown = false;
+  bool a = false;
+  bool b = false;
+  for (byte i = 0; i < LIST_MAX; i++) {
+    if ((kpd.key[i].kstate != PRESSED) && (kpd.key[i].kstate != HOLD)) continue;
+    if (kpd.key[i].kchar == 'a') a = true;
+    if (kpd.key[i].kchar == 'b') b = true;
+  }
+  bool pressed = a && b && !wasDown;
+  wasDown = a && b;
+  return pressed;
+}
+#endif
+//==============================================
+void printSettings() {
+  Serial.print(F("clock drift "));
+  Serial.print(Timebase::drift());
+  Serial.println(F(" ppm"));
+  if (sync.telemetryPeriod() == 0) {
+    Serial.println(F("telemetry off"));
+  } else {
+    Serial.print(F("telemetry every "));
+    Serial.print(sync.telemetryPeriod());
+    Serial.println(F(" ms"));
+  }
+  if (sync.id() == PROP_SYNC_OFF) {
+    Serial.println(F("sync off"));
+    return;
+  }
+  Serial.print(F("sync prop "));
+  Serial.print(sync.id());
+  if (!sync.isMaster()) {
+    Serial.print(sync.hearsMaster() ? F(", clock ") : F(", no master, clock was "));
+    Serial.print(sync.clockError());
+    Serial.print(F(" ms off"));
+  }
+  Serial.print(F(", owners"));
+  for (byte i = 0; i < PROP_SYNC_MAX_PROPS; i++) {
+    Serial.print(' ');
+    byte owner = sync.owner(i);
+    if (owner == NO_TEAM) Serial.print('-');
+    else Serial.print(owner + 1);
+  }
+  Serial.println();
+}
+
+// a command line: "c-120" sets the clock drift in ppm, "s0" makes the prop the master of the bus,
+// "t500" sends telemetry every 500 ms
+void runCommand(char command, bool negative, bool gotDigits, long number) {
+  if (command == 'l') {
+    eventLog.startDump(gameModeNames, GAME_MODES);
+    flags.dumpingLog = true;
+    return;
+  }
+  if (command == 'p') {
+    Serial.print(F("awake "));
+    Serial.print(power.awakePercent());
+    Serial.println(F("% since the last p"));
+    return;
+  }
+  if ((command == 'c') && gotDigits) {
+    Timebase::setDrift(negative ? -number : number);
+  } else if ((command == 's') && (gotDigits || negative)) {
+    sync.begin((negative || (number >= PROP_SYNC_MAX_PROPS)) ? PROP_SYNC_OFF : number);
+  } else if ((command == 't') && gotDigits) {
+    sync.setTelemetryPeriod((number > 60000) ? 60000 : number);
+  }
+  if (gotDigits || negative) {
+    Settings settings;
+    memset(&settings, 0, sizeof(settings));
+    settings.drift = Timebase::drift();
+    settings.syncId = sync.id();
+    settings.telemetryPeriod = sync.telemetryPeriod();
+    settingsStore.save(0, &settings);
+  }
+  printSettings();
+}
+
+// Lines of a command letter and maybe a number. l prints the event log, p the share of time awake, c, s and t print the settings,
+// with a number they set the clock drift in ppm, the id on the bus or the telemetry period in ms:
+// "c-120", "s0" for the master, "s-" for none, "t0" for no telemetry. Other lines are ignored whole, so what other props print on the bus is no command
+void readSerial() {
+  static char command; // 0 once the line is no command
+  static bool lineStart = true;
+  static bool negative;
+  static bool gotDigits;
+  static long number;
+  while (Serial.available()) {
+    char c = Serial.read();
+    if (sync.receive(c)) continue;
+    if ((c == '\n') || (c == '\r')) {
+      if (command) runCommand(command, negative, gotDigits, number);
+      command = 0;
+      lineStart = true;
+    } else if (lineStart) {
+      lineStart = false;
+      command = ((c == 'l') || (c == 'p') || (c == 'c') || (c == 's') || (c == 't')) ? c : 0;
+      negative = false;
+      gotDigits = false;
+      number = 0;
+    } else if ((c == '-') && !negative && !gotDigits) {
+      negative = true;
+    } else if ((c >= '0') && (c <= '9')) {
+      if (number <= TIMEBASE_MAX_DRIFT) number = number * 10 + (c - '0');
+      gotDigits = true;
+    } else {
+      command = 0;
+    }
+  }
+}
+
 void setup() {
-  // Serial.begin(115200);
+  Serial.begin(115200);
+  Settings settings;
+  if (settingsStore.load(0, &settings)) {
+    Timebase::setDrift(settings.drift);
+    sync.begin(settings.syncId);
+    sync.setTelemetryPeriod(settings.telemetryPeriod);
+  }
 
-  pinMode(T1_BTN_PIN, INPUT_PULLUP);
-  pinMode(T2_BTN_PIN, INPUT_PULLUP);
-  pinMode(BUZZER_PIN, OUTPUT);
-  pinMode(SIREN_PIN, OUTPUT);
+  buttons.begin();
+  sound.begin();
   #if CHECK_BATTERY
-    pinMode(CELL_PIN, INPUT);
-    pinMode(CELL_LED, OUTPUT);
+    battery.begin();
+    CellLedPin::output();
   #endif
 
-  noTone(BUZZER_PIN);
-
+  kpd.begin();
   kpd.setDebounceTime(10);
   kpd.setHoldTime(KEYPAD_LONG_PRESS_TIME);
   kpd.addEventListener(keypadEvent);
@@ -770,154 +1456,69 @@ void setup() {
   delay(100);
 
   #if CHECK_BATTERY
-    if ((digitalRead(T1_BTN_PIN) == LOW) || (digitalRead(T2_BTN_PIN) == LOW)) {
+    if (buttons.isPressed(0) || buttons.isPressed(1)) {
       printToLcd(false, 0, 0, F("Battery:"));
-      float cellVoltage = getBatteryVolts();
-      lcd.setCursor(9, 0);
-      lcd.print(cellVoltage);
+      printBatteryVoltage(9, 0);
+      lcdFb.flush();
       delay(3000);
     }
   #endif
 
-  setupProgmems();
-  setupScreens();
-
-  defusalLine.attach_function(1, defusal);
-  dominationLine.attach_function(1, domination);
-  zoneControlLine.attach_function(1, startZoneControl);
-  timerLine.attach_function(1, timer);
-  mainMenu.add_screen(mainScreen);
-
-  defusalDelayTime.attach_function(1, resetUserInput);
-  defusalBombTime.attach_function(1, resetUserInput);
-  defusalBombCode.attach_function(1, resetUserInput);
-  mainMenu.add_screen(defusalScreen);
-
-  timerDelayTime.attach_function(1, resetUserInput);
-  timerGameTime.attach_function(1, resetUserInput);
-  mainMenu.add_screen(timerScreen);
-
-  mainMenu.set_focusPosition(Position::LEFT);
-  mainMenu.switch_focus(1);
+  #if CHECK_BATTERY
+    tasks.runEvery(checkBattery, BATTERY_CHECK_INTERVAL);
+  #endif
 
   printToLcd(true, 1, 0, F("makerspace.lt"));
   printToLcd(false, 1, 1, F("Bomb prop v"));
   printToLcd(false, 12, 1, F(PROJECT_VERSION));
+  lcdFb.flush();
   delay(1500);
-  mainMenu.update();
+  mainMenu.show(&mainScreen, 0);
+  lcdFb.flush();
+  power.begin();
+  eventLog.begin();
+  #if LOOP_PROFILER
+    LoopProfiler::begin(); // after power.begin(), which stops Timer1
+  #endif
 }
 
 void loop() {
-  kpd.getKey(); // this is required to fire off attached events
+  PROFILE_START(PROFILE_LOOP);
+  PROFILE_START(PROFILE_KEYPAD);
+  kpd.getKey(); // fires the attached events, only scans while a key is down
+  PROFILE_STOP(PROFILE_KEYPAD);
 
-  #if CHECK_BATTERY
-    if (!lowBattery) checkBattery();
-  #endif
+  tasks.run();
 
-  if (sirenStartedMillis > 0) { // check to see if we need to stop the siren already, yo
-    if (isInGame() && (millis() - sirenStartedMillis) > SIREN_DURATION_START_GAME) useSiren(false);
-    else if (!isInGame() && (millis() - sirenStartedMillis) > SIREN_DURATION_END_GAME) useSiren(false);
-  }
+  ButtonEvent event;
+  while (buttons.read(event)) handleButtonEvent(event);
+  updateButtonHolds(Timebase::now());
 
-  if ((dominationStarted && showScore) || zoneControlStarted) {
-    if ((digitalRead(T1_BTN_PIN) == LOW) && !teamScoreSwitcher[0]) {
-      if (currMillisLoop == 0) currMillisLoop = millis();
-      int millisDiff = millis() - currMillisLoop;
-      if (!isDisarming) {
-        isDisarming = true;
-        lcd.clear();
-        lastMillis = 0; // set to 0 to show time immediately
-      }
-      if (zoneControlStarted) printedLine = false;
-      drawProgress(millisDiff, TEAM_SWITCH_TIME);
-      if (millisDiff >= TEAM_SWITCH_TIME) {
-        isDisarming = false;
-        lastMillis = 0; // set to 0 to show score immediately
-        currMillisLoop = 0;
-        teamScoreSwitcher[0] = true;
-        teamScoreSwitcher[1] = false;
-        tone(BUZZER_PIN, 700, 2000);
-      }
-    } else if ((digitalRead(T2_BTN_PIN) == LOW) && !teamScoreSwitcher[1]) {
-      if (currMillisLoop == 0) currMillisLoop = millis();
-      int millisDiff = millis() - currMillisLoop;
-      if (!isDisarming) {
-        isDisarming = true;
-        lcd.clear();
-        lastMillis = 0; // set to 0 to show time immediately
-      }
-      if (zoneControlStarted) printedLine = false;
-      drawProgress(millisDiff, TEAM_SWITCH_TIME);
-      if (millisDiff >= TEAM_SWITCH_TIME) {
-        isDisarming = false;
-        lastMillis = 0; // set to 0 to show score immediately
-        currMillisLoop = 0;
-        teamScoreSwitcher[0] = false;
-        teamScoreSwitcher[1] = true;
-        tone(BUZZER_PIN, 700, 2000);
-      }
-    } else { // if both buttons are not pressed
-      if (isDisarming) {
-        isDisarming = false;
-        lastMillis = 0; // set to 0 to show score immediately
-      }
-      if (currMillisLoop != 0) currMillisLoop = 0;
-    }
-  }
+  games.update(); // only the running mode's handler
 
-  if (defusalStarted && (defusalMillis[0] == 0)) {
-    if (ignoreBtn) {
-      // check if button was released after planting the bomb to not start defusing immediately if someone keeps holding the button
-      ignoreBtn = ((digitalRead(T1_BTN_PIN) == LOW) || (digitalRead(T2_BTN_PIN) == LOW));
-    }
-    // use any of two buttons to arm and defuse
-    if (!ignoreBtn && !useDefusalCode && ((digitalRead(T1_BTN_PIN) == LOW) || (digitalRead(T2_BTN_PIN) == LOW))) {
-      if (currMillisLoop == 0) {
-        currMillisLoop = millis();
-        lcd.clear();
-      }
-      int millisDiff = millis() - currMillisLoop;
-      if (!isArmed && !isDisarmed) {
-        if (!isArming) isArming = true;
-        printToLcd(false, 5, 0, F("ARMING"));
-        drawProgress(millisDiff, BOMB_ARM_TIME);
-        printedLine = false;
-        if (millisDiff >= BOMB_ARM_TIME) {
-          isArmed = true;
-          isArming = false;
-          lcd.clear();
-          tone(BUZZER_PIN, 700, 2000);
-          startedMillis = millis();
-          currMillisLoop = 0;
-          ignoreBtn = ((digitalRead(T1_BTN_PIN) == LOW) || (digitalRead(T2_BTN_PIN) == LOW));
-        }
-      } else if (!isDisarmed) {
-        if (!isDisarming) isDisarming = true;
-        printToLcd(false, 0, 0, F("DISARMING"));
-        printTime(defusalMillis[1]-currMillisDefusal, 10, 0);
-        drawProgress(millisDiff, BOMB_DEFUSE_TIME);
-        printedLine = false;
-        if (millisDiff >= BOMB_DEFUSE_TIME) {
-          isArmed = false;
-          isDisarmed = true;
-          isDisarming = false;
-          lcd.clear();
-        }
-      }
-    } else {
-      if (isArming) isArming = false;
-      if (isDisarming) isDisarming = false;
-      if (currMillisLoop != 0) currMillisLoop = 0;
-    }
-  }
+  // the end of a game is worth seeing
+  if (sound.isSirenPlaying()) power.activity();
+  power.update();
 
-  if (timerStarted) {
-    updateTimer();
-  } else if (dominationStarted) {
-    updateDomination();
-  } else if (zoneControlStarted) {
-    updateZoneControl();
-  } else if (defusalStarted) {
-    updateDefusal();
+  // a byte at a time, the EEPROM takes 3.3ms to write one
+  eventLog.update();
+  presets.update();
+  settingsStore.update();
+  readSerial();
+  sync.update(games.isRunning());
+  if (flags.dumpingLog && (Serial.availableForWrite() >= EVENT_LOG_LINE_MAX)) {
+    flags.dumpingLog = eventLog.dumpNext(Serial);
   }
+
+  // whatever does not fit into the display queue goes out on the next pass
+  PROFILE_START(PROFILE_LCD);
+  lcdFb.update();
+  PROFILE_STOP(PROFILE_LCD);
+  PROFILE_STOP(PROFILE_LOOP);
+  #if LOOP_PROFILER
+    // not timed, printing takes a while
+    if (profileChordPressed()) LoopProfiler::report(Serial, profileNames, PROFILE_SECTIONS);
+  #endif
+  // everything above is driven by interrupts and the clock, nothing changes before the next one
+  power.sleep();
 }
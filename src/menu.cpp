@@ -14,64 +14,109 @@ You should have received a copy of the GNU General Public License along with
 airsoft-bomb. If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include <LiquidMenu.h>
+#include <LcdMenu.h>
 
 #define MAX_USER_INPUT_LEN 3
 #define MAX_CODE_LEN 6
+#define TIME_SCREEN (MODE_TIMER || MODE_DOMINATION) // delay and game minutes, the two modes ask the same
 
-const char DELAY_STR[] PROGMEM = "Delay min: ";
-const char GAME_STR[] PROGMEM = "Game  min: ";
-const char CODE_STR[] PROGMEM = "Code: ";
-const char BOMB_STR[] PROGMEM = "Bomb  min: ";
-const char DEFUSAL_STR[] PROGMEM = "Defusal";
-const char DOMINATION_STR[] PROGMEM = "Domination";
-const char ZONE_CONTROL[] PROGMEM = "Zone Control";
-const char TIMER_STR[] PROGMEM = "Timer";
-const char START_STR[] PROGMEM = "START";
+#if TIME_SCREEN || MODE_DEFUSAL
+  const char DELAY_STR[] PROGMEM = "Delay min: ";
+  const char START_STR[] PROGMEM = "START";
+#endif
+#if TIME_SCREEN
+  const char GAME_STR[] PROGMEM = "Game  min: ";
+#endif
+#if MODE_DEFUSAL
+  const char CODE_STR[] PROGMEM = "Code: ";
+  const char BOMB_STR[] PROGMEM = "Bomb  min: ";
+  const char DEFUSAL_STR[] PROGMEM = "Defusal";
+#endif
+#if MODE_DOMINATION
+  const char DOMINATION_STR[] PROGMEM = "Domination";
+#endif
+#if MODE_ZONE_CONTROL
+  const char ZONE_CONTROL[] PROGMEM = "Zone Control";
+#endif
+#if MODE_TIMER
+  const char TIMER_STR[] PROGMEM = "Timer";
+#endif
 
 char userInputDelayStr[MAX_USER_INPUT_LEN+1];
-char* userInputDelayPtr = userInputDelayStr;
 char userInputGameStr[MAX_USER_INPUT_LEN+1];
-char* userInputGamePtr = userInputGameStr;
 char userInputBombStr[MAX_USER_INPUT_LEN+1];
-char* userInputBombPtr = userInputBombStr;
 char userInputCodeStr[MAX_CODE_LEN+1];
-char* userInputCodePtr = userInputCodeStr;
-byte userInputCount = 0;
-byte userCodeInputCount = 0;
 
-LiquidLine defusalLine(1, 0, DEFUSAL_STR);
-LiquidLine dominationLine(1, 1, DOMINATION_STR);
-LiquidLine zoneControlLine(1, 1, ZONE_CONTROL);
-LiquidLine timerLine(1, 1, TIMER_STR);
-LiquidScreen mainScreen(defusalLine, dominationLine, zoneControlLine, timerLine);
+// what the lines do, in main.cpp
+void defusal();
+void domination();
+void startZoneControl();
+void timer();
+void startDefusal();
+void startDomination();
+void startTimer();
 
-LiquidLine startLine(1, 1, START_STR);
+// the main screen lists the modes that are built, in this order
+enum MainMenuLine : byte {
+#if MODE_DEFUSAL
+  LINE_DEFUSAL,
+#endif
+#if MODE_DOMINATION
+  LINE_DOMINATION,
+#endif
+#if MODE_ZONE_CONTROL
+  LINE_ZONE_CONTROL,
+#endif
+#if MODE_TIMER
+  LINE_TIMER,
+#endif
+  MAIN_MENU_LINES
+};
 
-LiquidLine defusalDelayTime(1, 0, DELAY_STR, userInputDelayPtr);
-LiquidLine defusalBombTime(1, 1, BOMB_STR, userInputBombPtr);
-LiquidLine defusalBombCode(1, 1, CODE_STR, userInputCodePtr);
-LiquidScreen defusalScreen(defusalDelayTime, defusalBombTime, defusalBombCode, startLine);
+const MenuLine mainLines[MAIN_MENU_LINES] PROGMEM = {
+  // text, field, field size, action
+  #if MODE_DEFUSAL
+    { DEFUSAL_STR, NULL, 0, defusal },
+  #endif
+  #if MODE_DOMINATION
+    { DOMINATION_STR, NULL, 0, domination },
+  #endif
+  #if MODE_ZONE_CONTROL
+    { ZONE_CONTROL, NULL, 0, startZoneControl },
+  #endif
+  #if MODE_TIMER
+    { TIMER_STR, NULL, 0, timer },
+  #endif
+};
+const MenuScreen mainScreen PROGMEM = { mainLines, MAIN_MENU_LINES };
 
-LiquidLine timerDelayTime(1, 0, DELAY_STR, userInputDelayPtr);
-LiquidLine timerGameTime(1, 1, GAME_STR, userInputGamePtr);
-LiquidScreen timerScreen(timerDelayTime, timerGameTime, startLine);
+// 'c' on a field clears it, on START the game is checked and started
+#if MODE_DEFUSAL
+  const MenuLine defusalLines[] PROGMEM = {
+    { DELAY_STR, userInputDelayStr, MAX_USER_INPUT_LEN, NULL },
+    { BOMB_STR, userInputBombStr, MAX_USER_INPUT_LEN, NULL },
+    { CODE_STR, userInputCodeStr, MAX_CODE_LEN, NULL },
+    { START_STR, NULL, 0, startDefusal }
+  };
+  const MenuScreen defusalScreen PROGMEM = { defusalLines, sizeof(defusalLines) / sizeof(defusalLines[0]) };
+#endif
 
-void setupScreens() {
-    mainScreen.set_displayLineCount(2);
-    defusalScreen.set_displayLineCount(2);
-    timerScreen.set_displayLineCount(2);
-}
-
-void setupProgmems() {
-    defusalLine.set_asProgmem(1);
-    dominationLine.set_asProgmem(1);
-    zoneControlLine.set_asProgmem(1);
-    timerLine.set_asProgmem(1);
-    startLine.set_asProgmem(1);
-    defusalDelayTime.set_asProgmem(1);
-    defusalBombTime.set_asProgmem(1);
-    defusalBombCode.set_asProgmem(1);
-    timerDelayTime.set_asProgmem(1);
-    timerGameTime.set_asProgmem(1);
-}
\ No newline at end of file
+#if TIME_SCREEN
+  #define TIME_SCREEN_START 2 // the START line of the timer and domination screens
+#endif
+#if MODE_TIMER
+  const MenuLine timerLines[] PROGMEM = {
+    { DELAY_STR, userInputDelayStr, MAX_USER_INPUT_LEN, NULL },
+    { GAME_STR, userInputGameStr, MAX_USER_INPUT_LEN, NULL },
+    { START_STR, NULL, 0, startTimer }
+  };
+  const MenuScreen timerScreen PROGMEM = { timerLines, sizeof(timerLines) / sizeof(timerLines[0]) };
+#endif
+#if MODE_DOMINATION
+  const MenuLine dominationLines[] PROGMEM = {
+    { DELAY_STR, userInputDelayStr, MAX_USER_INPUT_LEN, NULL },
+    { GAME_STR, userInputGameStr, MAX_USER_INPUT_LEN, NULL },
+    { START_STR, NULL, 0, startDomination }
+  };
+  const MenuScreen dominationScreen PROGMEM = { dominationLines, sizeof(dominationLines) / sizeof(dominationLines[0]) };
+#endif